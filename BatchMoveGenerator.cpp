@@ -0,0 +1,385 @@
+#include "BatchMoveGenerator.h"
+#include <bitset>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Four bitboards, one per lane. Everything below is written once against these helpers.
+#if defined(__AVX2__)
+struct Bits {
+	__m256i v;
+};
+
+static inline Bits load(const uint64_t* p) { return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; }
+static inline void store(uint64_t* p, Bits a) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), a.v); }
+static inline Bits broadcast(uint64_t x) { return { _mm256_set1_epi64x(static_cast<long long>(x)) }; }
+static inline Bits operator&(Bits a, Bits b) { return { _mm256_and_si256(a.v, b.v) }; }
+static inline Bits operator|(Bits a, Bits b) { return { _mm256_or_si256(a.v, b.v) }; }
+static inline Bits operator+(Bits a, Bits b) { return { _mm256_add_epi64(a.v, b.v) }; }
+static inline Bits operator-(Bits a, Bits b) { return { _mm256_sub_epi64(a.v, b.v) }; }
+// a & ~b
+static inline Bits andNot(Bits a, Bits b) { return { _mm256_andnot_si256(b.v, a.v) }; }
+template<int N> static inline Bits shiftLeft(Bits a) { return { _mm256_slli_epi64(a.v, N) }; }
+template<int N> static inline Bits shiftRight(Bits a) { return { _mm256_srli_epi64(a.v, N) }; }
+
+// All ones in the lanes where a has any bit set
+static inline Bits anySet(Bits a) {
+	return andNot(broadcast(~0ULL), { _mm256_cmpeq_epi64(a.v, _mm256_setzero_si256()) });
+}
+
+// Nibble lookup, then the byte counts summed per 64-bit lane
+static inline Bits popCount(Bits a) {
+	const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m256i low = _mm256_set1_epi8(0x0f);
+	__m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(a.v, low)),
+		_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi64(a.v, 4), low)));
+	return { _mm256_sad_epu8(counts, _mm256_setzero_si256()) };
+}
+#else
+struct Bits {
+	uint64_t v[4];
+};
+
+template<class Op> static inline Bits lanewise(Bits a, Bits b, Op op) {
+	Bits r;
+	for (int i = 0; i < 4; ++i)
+		r.v[i] = op(a.v[i], b.v[i]);
+	return r;
+}
+
+static inline Bits load(const uint64_t* p) { return { { p[0], p[1], p[2], p[3] } }; }
+static inline void store(uint64_t* p, Bits a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+static inline Bits broadcast(uint64_t x) { return { { x, x, x, x } }; }
+static inline Bits operator&(Bits a, Bits b) { return lanewise(a, b, [](uint64_t x, uint64_t y) { return x & y; }); }
+static inline Bits operator|(Bits a, Bits b) { return lanewise(a, b, [](uint64_t x, uint64_t y) { return x | y; }); }
+static inline Bits operator+(Bits a, Bits b) { return lanewise(a, b, [](uint64_t x, uint64_t y) { return x + y; }); }
+static inline Bits operator-(Bits a, Bits b) { return lanewise(a, b, [](uint64_t x, uint64_t y) { return x - y; }); }
+// a & ~b
+static inline Bits andNot(Bits a, Bits b) { return lanewise(a, b, [](uint64_t x, uint64_t y) { return x & ~y; }); }
+template<int N> static inline Bits shiftLeft(Bits a) { return lanewise(a, a, [](uint64_t x, uint64_t) { return x << N; }); }
+template<int N> static inline Bits shiftRight(Bits a) { return lanewise(a, a, [](uint64_t x, uint64_t) { return x >> N; }); }
+
+// All ones in the lanes where a has any bit set
+static inline Bits anySet(Bits a) { return lanewise(a, a, [](uint64_t x, uint64_t) { return x ? ~0ULL : 0; }); }
+
+static inline Bits popCount(Bits a) {
+	return lanewise(a, a, [](uint64_t x, uint64_t) { return static_cast<uint64_t>(bitset<64>(x).count()); });
+}
+#endif
+
+static constexpr uint64_t NotFileA = 0xfefefefefefefefeULL;
+static constexpr uint64_t NotFileH = 0x7f7f7f7f7f7f7f7fULL;
+static constexpr uint64_t NotFileAB = 0xfcfcfcfcfcfcfcfcULL;
+static constexpr uint64_t NotFileGH = 0x3f3f3f3f3f3f3f3fULL;
+static constexpr uint64_t Rank3 = 0x0000000000ff0000ULL;
+static constexpr uint64_t Rank8 = 0xff00000000000000ULL;
+
+// Shift by a square offset: up the board for positive offsets, down for negative
+template<int Offset> static inline Bits shift(Bits a) {
+	if constexpr (Offset > 0)
+		return shiftLeft<Offset>(a);
+	else
+		return shiftRight<-Offset>(a);
+}
+
+// Squares that cannot be reached by a one step move in a direction without wrapping a file
+template<int Direction> static constexpr uint64_t landingMask() {
+	return (Direction == 1 || Direction == 9 || Direction == -7) ? NotFileA
+		: (Direction == -1 || Direction == 7 || Direction == -9) ? NotFileH : ~0ULL;
+}
+
+template<int Direction> static inline Bits step(Bits a) {
+	return shift<Direction>(a) & broadcast(landingMask<Direction>());
+}
+
+// Kogge-Stone fill: every square a slider on 'from' reaches in one direction, up to and
+// including the first occupied square
+template<int Direction> static inline Bits slide(Bits from, Bits empty) {
+	Bits pro = empty & broadcast(landingMask<Direction>());
+	Bits gen = from;
+	gen = gen | (pro & shift<Direction>(gen));
+	pro = pro & shift<Direction>(pro);
+	gen = gen | (pro & shift<2 * Direction>(gen));
+	pro = pro & shift<2 * Direction>(pro);
+	gen = gen | (pro & shift<4 * Direction>(gen));
+	return step<Direction>(gen);
+}
+
+static inline Bits pawnAttacksUp(Bits pawns) { return step<7>(pawns) | step<9>(pawns); }
+static inline Bits pawnAttacksDown(Bits pawns) { return step<-7>(pawns) | step<-9>(pawns); }
+
+template<int Offset, uint64_t Mask> static inline Bits jump(Bits a) {
+	return shift<Offset>(a) & broadcast(Mask);
+}
+
+static inline Bits knightAttacks(Bits knights) {
+	return jump<17, NotFileA>(knights) | jump<15, NotFileH>(knights) | jump<10, NotFileAB>(knights) | jump<6, NotFileGH>(knights)
+		| jump<-6, NotFileAB>(knights) | jump<-10, NotFileGH>(knights) | jump<-15, NotFileA>(knights) | jump<-17, NotFileH>(knights);
+}
+
+// Two knights can land on one square, but not with the same jump: count jump by jump
+static inline Bits countKnightMoves(Bits knights, Bits allowed) {
+	return popCount(jump<17, NotFileA>(knights) & allowed) + popCount(jump<15, NotFileH>(knights) & allowed)
+		+ popCount(jump<10, NotFileAB>(knights) & allowed) + popCount(jump<6, NotFileGH>(knights) & allowed)
+		+ popCount(jump<-6, NotFileAB>(knights) & allowed) + popCount(jump<-10, NotFileGH>(knights) & allowed)
+		+ popCount(jump<-15, NotFileA>(knights) & allowed) + popCount(jump<-17, NotFileH>(knights) & allowed);
+}
+
+static inline Bits kingAttacks(Bits king) {
+	return step<8>(king) | step<-8>(king) | step<1>(king) | step<-1>(king)
+		| step<9>(king) | step<7>(king) | step<-7>(king) | step<-9>(king);
+}
+
+static inline Bits sliderAttacks(Bits diagonal, Bits straight, Bits empty) {
+	return slide<8>(straight, empty) | slide<-8>(straight, empty) | slide<1>(straight, empty) | slide<-1>(straight, empty)
+		| slide<9>(diagonal, empty) | slide<7>(diagonal, empty) | slide<-7>(diagonal, empty) | slide<-9>(diagonal, empty);
+}
+
+// Rays, checks and pins are worked out per direction; pins are kept per line (vertical,
+// horizontal, a1-h8, h1-a8) because a pinned piece may still move along its own line
+template<int Direction> static constexpr int lineOf() {
+	return (Direction == 8 || Direction == -8) ? 0 : (Direction == 1 || Direction == -1) ? 1
+		: (Direction == 9 || Direction == -9) ? 2 : 3;
+}
+
+template<int Direction> static constexpr bool isDiagonal() { return lineOf<Direction>() >= 2; }
+
+struct Position {
+	Bits us[6], them[6];
+	Bits own, enemy, empty;
+	Bits target;        // where non-king moves may land: everywhere, or onto the check line
+	Bits pinned;
+	Bits pinnedOn[4];
+};
+
+template<int Direction> static inline void scanFromKing(Position& p, Bits& checkers, Bits& checkLines) {
+	Bits sliders = isDiagonal<Direction>() ? (p.them[BatchMoveGenerator::Bishops] | p.them[BatchMoveGenerator::Queens])
+		: (p.them[BatchMoveGenerator::Rooks] | p.them[BatchMoveGenerator::Queens]);
+	Bits ray = slide<Direction>(p.us[BatchMoveGenerator::King], p.empty);
+	Bits hit = ray & sliders;
+	checkers = checkers | hit;
+	checkLines = checkLines | (ray & anySet(hit));
+
+	Bits blocker = ray & p.own;
+	Bits pin = blocker & anySet(slide<Direction>(blocker, p.empty) & sliders);
+	p.pinned = p.pinned | pin;
+	p.pinnedOn[lineOf<Direction>()] = p.pinnedOn[lineOf<Direction>()] | pin;
+}
+
+// Pieces that may move in a direction: free ones, and those pinned on that line. The rays of
+// different sliders in one direction never overlap (the rear one stops behind the front one),
+// so one fill counts them all.
+template<int Direction> static inline Bits countSlides(const Position& p) {
+	Bits sliders = isDiagonal<Direction>() ? (p.us[BatchMoveGenerator::Bishops] | p.us[BatchMoveGenerator::Queens])
+		: (p.us[BatchMoveGenerator::Rooks] | p.us[BatchMoveGenerator::Queens]);
+	Bits movers = andNot(sliders, p.pinned) | (sliders & p.pinnedOn[lineOf<Direction>()]);
+	return popCount(andNot(slide<Direction>(movers, p.empty), p.own) & p.target);
+}
+
+template<int Direction> static inline Bits countPawnCaptures(const Position& p) {
+	Bits pawns = p.us[BatchMoveGenerator::Pawns];
+	Bits movers = andNot(pawns, p.pinned) | (pawns & p.pinnedOn[lineOf<Direction>()]);
+	Bits captures = step<Direction>(movers) & p.enemy & p.target;
+	return popCount(andNot(captures, broadcast(Rank8))) + shiftLeft<2>(popCount(captures & broadcast(Rank8)));
+}
+
+static int lowestBit(uint64_t bits) {
+	static const int DeBruijn[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+	};
+	return DeBruijn[((bits & (0 - bits)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
+
+// Byte swap: rank 1 becomes rank 8
+static uint64_t flipRanks(uint64_t bits) {
+	bits = ((bits >> 8) & 0x00ff00ff00ff00ffULL) | ((bits & 0x00ff00ff00ff00ffULL) << 8);
+	bits = ((bits >> 16) & 0x0000ffff0000ffffULL) | ((bits & 0x0000ffff0000ffffULL) << 16);
+	return (bits >> 32) | (bits << 32);
+}
+
+// Scalar attack test for the en passant check, where two pawns leave one rank at once
+static bool attackedAfter(int square, uint64_t occupied, uint64_t pawns, uint64_t knights,
+	uint64_t diagonal, uint64_t straight) {
+	uint64_t bit = 1ULL << square;
+	if ((((bit << 7) & NotFileH) | ((bit << 9) & NotFileA)) & pawns)
+		return true;
+	for (int to : PrecomputedMoveData::knightMoves[square]) {
+		if (knights & (1ULL << to))
+			return true;
+	}
+	for (int dir = 0; dir < 8; ++dir) {
+		uint64_t sliders = dir < 4 ? straight : diagonal;
+		for (int n = 1; n <= PrecomputedMoveData::NumSquaresToEdge[square][dir]; ++n) {
+			uint64_t to = 1ULL << (square + PrecomputedMoveData::DirectionOffsets[dir] * n);
+			if (sliders & to)
+				return true;
+			if (occupied & to)
+				break;
+		}
+	}
+	return false;
+}
+
+static int specialMoves(const BatchMoveGenerator::Batch& batch, size_t i, uint64_t threats) {
+	using B = BatchMoveGenerator;
+	uint64_t own = 0, enemy = 0;
+	for (int t = 0; t < 6; ++t) {
+		own |= batch.us[t][i];
+		enemy |= batch.them[t][i];
+	}
+	uint64_t occupied = own | enemy;
+	uint64_t king = batch.us[B::King][i];
+	if (!king)
+		return 0;
+
+	int moves = 0;
+	uint8_t castling = batch.castling[i];
+	if (castling && king == (1ULL << 4) && !(threats & king)) {
+		if ((castling & 1) && (batch.us[B::Rooks][i] & (1ULL << 7)) && !(occupied & 0x60) && !(threats & 0x60))
+			++moves;
+		if ((castling & 2) && (batch.us[B::Rooks][i] & 1) && !(occupied & 0x0e) && !(threats & 0x0c))
+			++moves;
+	}
+
+	int ep = batch.enPassant[i];
+	if (ep >= 0) {
+		int kingSquare = lowestBit(king);
+		uint64_t captured = 1ULL << (ep - 8);
+		uint64_t diagonal = batch.them[B::Bishops][i] | batch.them[B::Queens][i];
+		uint64_t straight = batch.them[B::Rooks][i] | batch.them[B::Queens][i];
+		for (int from : { ep - 9, ep - 7 }) {
+			if (abs(from % 8 - ep % 8) != 1 || !(batch.us[B::Pawns][i] & (1ULL << from)))
+				continue;
+			uint64_t after = (occupied ^ (1ULL << from) ^ captured) | (1ULL << ep);
+			if (!attackedAfter(kingSquare, after, batch.them[B::Pawns][i] & ~captured, batch.them[B::Knights][i], diagonal, straight))
+				++moves;
+		}
+	}
+	return moves;
+}
+
+void BatchMoveGenerator::Batch::clear() {
+	for (int t = 0; t < 6; ++t) {
+		us[t].clear();
+		them[t].clear();
+	}
+	castling.clear();
+	enPassant.clear();
+	flipped.clear();
+	count = 0;
+}
+
+void BatchMoveGenerator::Batch::add(const Board& board) {
+	// Grow a whole group of lanes at a time so loads never run past the end
+	if (count % Lanes == 0) {
+		for (int t = 0; t < 6; ++t) {
+			us[t].resize(count + Lanes, 0);
+			them[t].resize(count + Lanes, 0);
+		}
+		castling.resize(count + Lanes, 0);
+		enPassant.resize(count + Lanes, -1);
+		flipped.resize(count + Lanes, 0);
+	}
+
+	bool black = board.colorToMove == Piece::Black;
+	int flip = black ? 56 : 0;
+	for (int square = 0; square < 64; ++square) {
+		int piece = board.Square[square];
+		if (piece == Piece::None)
+			continue;
+		uint64_t bit = 1ULL << (square ^ flip);
+		int t = Piece::Type(piece) - 1;
+		if (Piece::IsColor(piece, board.colorToMove))
+			us[t][count] |= bit;
+		else
+			them[t][count] |= bit;
+	}
+
+	const CastlingRights& rights = board.castlingRights;
+	bool kingside = black ? rights.blackKingside : rights.whiteKingside;
+	bool queenside = black ? rights.blackQueenside : rights.whiteQueenside;
+	castling[count] = static_cast<uint8_t>((kingside ? 1 : 0) | (queenside ? 2 : 0));
+	enPassant[count] = static_cast<int8_t>(board.enPassantSquare < 0 ? -1 : (board.enPassantSquare ^ flip));
+	flipped[count] = black;
+	++count;
+}
+
+void BatchMoveGenerator::analyse(const Batch& batch, Result& result) {
+	size_t n = batch.size();
+	result.threats.resize(n);
+	result.inCheck.resize(n);
+	result.legalMoves.resize(n);
+
+	for (size_t i = 0; i < n; i += Lanes) {
+		Position p;
+		for (int t = 0; t < 6; ++t) {
+			p.us[t] = load(&batch.us[t][i]);
+			p.them[t] = load(&batch.them[t][i]);
+		}
+		p.own = p.us[0] | p.us[1] | p.us[2] | p.us[3] | p.us[4] | p.us[5];
+		p.enemy = p.them[0] | p.them[1] | p.them[2] | p.them[3] | p.them[4] | p.them[5];
+		p.empty = andNot(broadcast(~0ULL), p.own | p.enemy);
+
+		Bits king = p.us[King];
+		Bits diagonal = p.them[Bishops] | p.them[Queens];
+		Bits straight = p.them[Rooks] | p.them[Queens];
+		Bits leapers = pawnAttacksDown(p.them[Pawns]) | knightAttacks(p.them[Knights]) | kingAttacks(p.them[King]);
+		Bits threats = leapers | sliderAttacks(diagonal, straight, p.empty);
+		// The king may not step back along a line it is checked on: look through it
+		Bits danger = leapers | sliderAttacks(diagonal, straight, p.empty | king);
+
+		Bits checkers = (p.them[Pawns] & pawnAttacksUp(king)) | (p.them[Knights] & knightAttacks(king));
+		Bits checkLines = broadcast(0);
+		p.pinned = broadcast(0);
+		for (Bits& line : p.pinnedOn)
+			line = broadcast(0);
+		scanFromKing<8>(p, checkers, checkLines);
+		scanFromKing<-8>(p, checkers, checkLines);
+		scanFromKing<1>(p, checkers, checkLines);
+		scanFromKing<-1>(p, checkers, checkLines);
+		scanFromKing<9>(p, checkers, checkLines);
+		scanFromKing<7>(p, checkers, checkLines);
+		scanFromKing<-7>(p, checkers, checkLines);
+		scanFromKing<-9>(p, checkers, checkLines);
+
+		// Not in check: anywhere; one checker: capture it or block; two: king moves only
+		Bits inCheck = anySet(checkers);
+		Bits doubleCheck = anySet(checkers & (checkers - broadcast(1)));
+		p.target = andNot(andNot(broadcast(~0ULL), inCheck) | checkers | checkLines, doubleCheck);
+
+		Bits moves = popCount(andNot(kingAttacks(king), p.own | danger));
+
+		Bits knights = andNot(p.us[Knights], p.pinned);
+		moves = moves + countKnightMoves(knights, andNot(p.target, p.own));
+
+		moves = moves + countSlides<8>(p) + countSlides<-8>(p) + countSlides<1>(p) + countSlides<-1>(p)
+			+ countSlides<9>(p) + countSlides<7>(p) + countSlides<-7>(p) + countSlides<-9>(p);
+
+		Bits pushers = andNot(p.us[Pawns], p.pinned) | (p.us[Pawns] & p.pinnedOn[lineOf<8>()]);
+		Bits single = step<8>(pushers) & p.empty;
+		Bits twice = step<8>(single & broadcast(Rank3)) & p.empty & p.target;
+		single = single & p.target;
+		moves = moves + popCount(andNot(single, broadcast(Rank8))) + shiftLeft<2>(popCount(single & broadcast(Rank8)))
+			+ popCount(twice) + countPawnCaptures<7>(p) + countPawnCaptures<9>(p);
+
+		uint64_t laneThreats[Lanes], laneCheck[Lanes], laneMoves[Lanes];
+		store(laneThreats, threats);
+		store(laneCheck, inCheck);
+		store(laneMoves, moves);
+
+		for (size_t lane = 0; lane < Lanes && i + lane < n; ++lane) {
+			size_t j = i + lane;
+			int special = specialMoves(batch, j, laneThreats[lane]);
+			result.threats[j] = batch.flipped[j] ? flipRanks(laneThreats[lane]) : laneThreats[lane];
+			result.inCheck[j] = laneCheck[lane] != 0;
+			result.legalMoves[j] = static_cast<uint16_t>(laneMoves[lane] + special);
+		}
+	}
+}
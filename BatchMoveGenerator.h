@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Board.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Attack sets, check status and legal move counts for many independent positions at once.
+// Boards are kept as bitboards in structure-of-arrays form, each seen from its side to move
+// (positions with black to move are flipped vertically), so pawns push the same way in every
+// lane and one set of shifts serves all of them. Four boards go through each step together:
+// one AVX2 register when the build targets it (-mavx2, /arch:AVX2), four 64-bit words otherwise.
+//
+// Moves are counted set-wise, never listed: per direction for sliders, per jump for knights,
+// with pins and check evasions applied as masks. Castling and en passant need a couple of
+// scalar tests and are finished lane by lane. Counts match moveGenerator::GenerateLegalMoves.
+class BatchMoveGenerator {
+public:
+	static const int Lanes = 4;
+
+	// Index into Batch::us / Batch::them
+	enum PieceIndex { Pawns, Knights, Bishops, Rooks, Queens, King };
+
+	// Storage is padded with empty boards to a multiple of Lanes
+	struct Batch {
+		vector<uint64_t> us[6];     // side to move, rank 1 is its home rank
+		vector<uint64_t> them[6];
+		vector<uint8_t> castling;   // bit 0 kingside, bit 1 queenside, side to move only
+		vector<int8_t> enPassant;   // relative square, -1 if none
+		vector<uint8_t> flipped;    // black to move
+
+		void clear();
+		void add(const Board& board);
+		size_t size() const { return count; }
+
+	private:
+		size_t count = 0;
+	};
+
+	struct Result {
+		vector<uint64_t> threats;   // squares attacked by the side not to move, a1 = bit 0
+		vector<uint8_t> inCheck;
+		vector<uint16_t> legalMoves;
+	};
+
+	static void analyse(const Batch& batch, Result& result);
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Search.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Fixed-depth, single-threaded search over a built-in position set. The total node
+// count is a signature of engine behaviour: it only changes when move generation,
+// makeMove, evaluation or search change. Nodes/second tracks speed.
+class Bench {
+public:
+	static const int DefaultDepth = 5;
+	static const vector<string> Positions;
+
+	// Prints per-position nodes, then the total node signature and nodes/second
+	static uint64_t run(int depth = DefaultDepth);
+};
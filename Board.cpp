@@ -1,33 +1,9 @@
 #include "Board.h"
+#include "Material.h"
 
 Board::Board() {
-
-	Piece::fenToBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", Square);
-
-	//for (int i = 0; i < 64; i++) {
-	//	Square[i] = Piece::None;
-	//}
-	//
-	//Square[0] = Piece::White | Piece::Rook;
-	//Square[1] = Piece::White | Piece::Knight;
-	//Square[2] = Piece::White | Piece::Bishop;
-	//Square[3] = Piece::White | Piece::Queen;
-	//Square[4] = Piece::White | Piece::King;
-	//Square[5] = Piece::White | Piece::Bishop;
-	//Square[6] = Piece::White | Piece::Knight;
-	//Square[7] = Piece::White | Piece::Rook;
-	//
-	//for (int i = 8; i < 16; i++) Square[i] = Piece::White | Piece::Pawn;
-	//for (int i = 48; i < 56; i++) Square[i] = Piece::Black | Piece::Pawn;
-	//
-	//Square[56] = Piece::Black | Piece::Rook;
-	//Square[57] = Piece::Black | Piece::Knight;
-	//Square[58] = Piece::Black | Piece::Bishop;
-	//Square[59] = Piece::Black | Piece::Queen;
-	//Square[60] = Piece::Black | Piece::King;
-	//Square[61] = Piece::Black | Piece::Bishop;
-	//Square[62] = Piece::Black | Piece::Knight;
-	//Square[63] = Piece::Black | Piece::Rook;
+	initZobrist();
+	setFen(StartFen);
 }
 
 int Board::getCastlingRightsMask() const {
@@ -66,7 +42,7 @@ uint64_t Board::computeZobristHash(const Board& board) const {
 	uint64_t hash = 0;
 
 	for (int sq = 0; sq < 64; ++sq) {
-		int p = Piece::getPiece(Square[sq]);
+		int p = Square[sq];
 		if (p != Piece::None) {
 			int pieceIndex = Piece::getIndex(p); // map piece enum to 0-11
 			hash ^= zobristTable[sq][pieceIndex];
@@ -87,14 +63,174 @@ uint64_t Board::computeZobristHash(const Board& board) const {
 }
 
 
-void Board::recordPosition(Board& board) {
-	uint64_t hash = computeZobristHash(board);
-	repetitionMap[hash]++;
+void Board::recordPosition() {
+	repetitionMap[zobristKey]++;
+}
+
+bool Board::isThreefoldRepetition() {
+	return repetitionMap[zobristKey] >= 3;
+}
+
+// Parses "placement side castling ep [halfmove fullmove]". EPD lines stop after the
+// fourth field, anything that follows (operations) is ignored. Rebuilds every derived field.
+bool Board::setFen(const char* fen, size_t length) {
+	const char* p = fen;
+	const char* end = fen + length;
+
+	auto skipSpaces = [&]() { while (p < end && (*p == ' ' || *p == '\t')) ++p; };
+
+	for (int i = 0; i < 64; ++i)
+		Square[i] = Piece::None;
+
+	// 1. Piece placement
+	skipSpaces();
+	int rank = 7, file = 0;
+	for (; p < end && *p != ' '; ++p) {
+		char c = *p;
+		if (c == '/') {
+			rank--;
+			file = 0;
+		}
+		else if (c >= '1' && c <= '8') {
+			file += c - '0';
+		}
+		else {
+			int type = Piece::None;
+			switch (c | 0x20) { // lower case
+			case 'p': type = Piece::Pawn;   break;
+			case 'n': type = Piece::Knight; break;
+			case 'b': type = Piece::Bishop; break;
+			case 'r': type = Piece::Rook;   break;
+			case 'q': type = Piece::Queen;  break;
+			case 'k': type = Piece::King;   break;
+			default: return false;
+			}
+			if (rank < 0 || file > 7)
+				return false;
+			Square[rank * 8 + file] = Piece::MakePiece((c >= 'a') ? Piece::Black : Piece::White, type);
+			file++;
+		}
+	}
+
+	// 2. Side to move
+	skipSpaces();
+	colorToMove = (p < end && *p == 'b') ? Piece::Black : Piece::White;
+	while (p < end && *p != ' ') ++p;
+
+	// 3. Castling rights
+	skipSpaces();
+	castlingRights.whiteKingside = castlingRights.whiteQueenside = false;
+	castlingRights.blackKingside = castlingRights.blackQueenside = false;
+	for (; p < end && *p != ' '; ++p) {
+		switch (*p) {
+		case 'K': castlingRights.whiteKingside = true;  break;
+		case 'Q': castlingRights.whiteQueenside = true; break;
+		case 'k': castlingRights.blackKingside = true;  break;
+		case 'q': castlingRights.blackQueenside = true; break;
+		}
+	}
+
+	// moveGenerator looks at the moved flags, keep them in line with the rights
+	whiteKingsideRookMoved = !castlingRights.whiteKingside;
+	whiteQueensideRookMoved = !castlingRights.whiteQueenside;
+	blackKingsideRookMoved = !castlingRights.blackKingside;
+	blackQueensideRookMoved = !castlingRights.blackQueenside;
+	whiteKingMoved = whiteKingsideRookMoved && whiteQueensideRookMoved;
+	blackKingMoved = blackKingsideRookMoved && blackQueensideRookMoved;
+
+	// 4. En passant target
+	skipSpaces();
+	enPassantSquare = -1;
+	if (p + 1 < end && p[0] >= 'a' && p[0] <= 'h' && p[1] >= '1' && p[1] <= '8')
+		enPassantSquare = (p[1] - '1') * 8 + (p[0] - 'a');
+	while (p < end && *p != ' ') ++p;
+
+	// 5./6. Clocks, optional (EPD has operations here instead)
+	auto readNumber = [&](int fallback) {
+		skipSpaces();
+		if (p >= end || *p < '0' || *p > '9')
+			return fallback;
+		int value = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+			value = value * 10 + (*p++ - '0');
+		return value;
+	};
+	halfmoveClock = readNumber(0);
+	fullmoveNumber = max(1, readNumber(1));
+
+	// Derived state
+	kingSquares[0] = kingSquares[1] = -1;
+	for (int sq = 0; sq < 64; ++sq) {
+		if (Square[sq] == Piece::WhiteKing) kingSquares[0] = sq;
+		if (Square[sq] == Piece::BlackKing) kingSquares[1] = sq;
+	}
+	zobristKey = computeZobristHash(*this);
+	computeMaterial();
+	repetitionMap.clear();
+
+	return kingSquares[0] != -1 && kingSquares[1] != -1;
+}
+
+void Board::computeMaterial() {
+	fill(begin(pieceCounts), end(pieceCounts), 0);
+	pieceTotal = 0;
+	materialKey = 0;
+	for (int sq = 0; sq < 64; ++sq) {
+		if (Square[sq] == Piece::None)
+			continue;
+		pieceCounts[Square[sq]]++;
+		pieceTotal++;
+		materialKey += Material::weight(Square[sq], sq);
+	}
+}
+
+bool Board::setFen(const string& fen) {
+	return setFen(fen.data(), fen.size());
 }
 
-bool Board::isThreefoldRepetition(Board& board) {
-	uint64_t hash = computeZobristHash(board);
-	return repetitionMap[hash] >= 3;
+string Board::getFen() const {
+	string fen;
+	fen.reserve(90);
+
+	for (int rank = 7; rank >= 0; --rank) {
+		int empty = 0;
+		for (int file = 0; file < 8; ++file) {
+			int piece = Square[rank * 8 + file];
+			if (piece == Piece::None) {
+				empty++;
+				continue;
+			}
+			if (empty > 0) {
+				fen += static_cast<char>('0' + empty);
+				empty = 0;
+			}
+			fen += pieceChar(piece);
+		}
+		if (empty > 0)
+			fen += static_cast<char>('0' + empty);
+		if (rank > 0)
+			fen += '/';
+	}
+
+	fen += (colorToMove == Piece::White) ? " w " : " b ";
+
+	if (castlingRights.whiteKingside)  fen += 'K';
+	if (castlingRights.whiteQueenside) fen += 'Q';
+	if (castlingRights.blackKingside)  fen += 'k';
+	if (castlingRights.blackQueenside) fen += 'q';
+	if (getCastlingRightsMask() == 0)  fen += '-';
+
+	fen += ' ';
+	if (enPassantSquare != -1) {
+		fen += static_cast<char>('a' + enPassantSquare % 8);
+		fen += static_cast<char>('1' + enPassantSquare / 8);
+	}
+	else {
+		fen += '-';
+	}
+
+	fen += ' ' + to_string(halfmoveClock) + ' ' + to_string(fullmoveNumber);
+	return fen;
 }
 
 
@@ -120,6 +256,11 @@ bool Board::IsPathClear(int from, int to, const Board& board) {
 }
 
 int Board::findKingSquare(int color) const {
+	int cached = kingSquares[color == Piece::White ? 0 : 1];
+	if (cached != -1 && Square[cached] == Piece::MakePiece(color, Piece::King))
+		return cached;
+
+	// Square was edited directly, fall back to a scan
 	for (int sq = 0; sq < 64; ++sq) {
 		if (Piece::IsKing(Square[sq]) && Piece::IsColor(Square[sq], color))
 			return sq;
@@ -127,71 +268,280 @@ int Board::findKingSquare(int color) const {
 	return -1;
 }
 
+// Looks outward from the square for each kind of attacker instead of going through every
+// piece of byColor: a legality test after one move costs a few dozen square reads
 bool Board::isSquareAttacked(int square, int byColor, const Board& board) {
-	for (int from = 0; from < 64; ++from) {
-		int piece = board.Square[from];
-		if (!Piece::IsColor(piece, byColor))
-			continue;
+	// Pawns attack from one rank behind them, on either neighbouring file
+	int pawn = Piece::MakePiece(byColor, Piece::Pawn);
+	int from = square + ((byColor == Piece::White) ? -8 : 8);
+	int file = square % 8;
+	if (from >= 0 && from < 64) {
+		if (file > 0 && board.Square[from - 1] == pawn) return true;
+		if (file < 7 && board.Square[from + 1] == pawn) return true;
+	}
 
-		int pieceType = Piece::Type(piece);
+	int knight = Piece::MakePiece(byColor, Piece::Knight);
+	for (int move : PrecomputedMoveData::knightMoves[square]) {
+		if (board.Square[move] == knight) return true;
+	}
 
-		switch (pieceType) {
-		case Piece::Pawn: {
-			int dir = (byColor == Piece::White) ? 1 : -1;
-			int targetRank = from / 8 + dir;
+	int king = Piece::MakePiece(byColor, Piece::King);
+	for (int move : PrecomputedMoveData::kingMoves[square]) {
+		if (board.Square[move] == king) return true;
+	}
 
-			// Diagonal attacks only valid if targetRank is in bounds
-			if (targetRank >= 0 && targetRank < 8) {
-				int file = from % 8;
-				if (file > 0 && from + dir * 8 - 1 == square) return true; // capture left
-				if (file < 7 && from + dir * 8 + 1 == square) return true; // capture right
-			}
+	// Sliders: the first piece along each ray, directions 0-3 straight and 4-7 diagonal
+	int queen = Piece::MakePiece(byColor, Piece::Queen);
+	for (int dir = 0; dir < 8; ++dir) {
+		int slider = Piece::MakePiece(byColor, dir < 4 ? Piece::Rook : Piece::Bishop);
+		int offset = PrecomputedMoveData::DirectionOffsets[dir];
+		for (int n = 1; n <= PrecomputedMoveData::NumSquaresToEdge[square][dir]; ++n) {
+			int piece = board.Square[square + offset * n];
+			if (piece == Piece::None)
+				continue;
+			if (piece == slider || piece == queen) return true;
 			break;
 		}
+	}
 
-		case Piece::Knight: {
-			for (int move : PrecomputedMoveData::knightMoves[from]) {
-				if (move == square) return true;
-			}
-			break;
-		}
-		case Piece::Bishop: {
-			for (int move : PrecomputedMoveData::bishopMoves[from]) {
-				if (move == square) {
-					if (Board::IsPathClear(from, move, board)) return true;
-				}
-			}
-			break;
-		}
-		case Piece::Rook: {
-			for (int move : PrecomputedMoveData::rookMoves[from]) {
-				if (move == square) {
-					if (Board::IsPathClear(from, move, board)) return true;
-				}
-			}
-			break;
-		}
-		case Piece::Queen: {
-			for (int move : PrecomputedMoveData::queenMoves[from]) {
-				if (move == square) {
-					if (Board::IsPathClear(from, move, board)) return true;
-				}
-			}
-			break;
+	return false; // No attackers found
+}
+
+// Index into DirectionOffsets of the ray from one square through another, -1 if they share no line
+static int directionTo(int from, int to) {
+	int rankDelta = to / 8 - from / 8, fileDelta = to % 8 - from % 8;
+	if (from == to || (rankDelta != 0 && fileDelta != 0 && abs(rankDelta) != abs(fileDelta)))
+		return -1;
+	int offset = (rankDelta > 0) - (rankDelta < 0);
+	offset = offset * 8 + (fileDelta > 0) - (fileDelta < 0);
+	for (int dir = 0; dir < 8; ++dir) {
+		if (PrecomputedMoveData::DirectionOffsets[dir] == offset)
+			return dir;
+	}
+	return -1;
+}
+
+static int squareDistance(int a, int b) {
+	return max(abs(a / 8 - b / 8), abs(a % 8 - b % 8));
+}
+
+// First occupied square from 'from' along dir, -1 if the ray runs off the board
+static int firstPiece(const Board& board, int from, int dir) {
+	for (int n = 1; n <= PrecomputedMoveData::NumSquaresToEdge[from][dir]; ++n) {
+		int square = from + PrecomputedMoveData::DirectionOffsets[dir] * n;
+		if (board.Square[square] != Piece::None)
+			return square;
+	}
+	return -1;
+}
+
+static bool slidesAlong(int piece, int color, int dir) {
+	return piece == Piece::MakePiece(color, Piece::Queen)
+		|| piece == Piece::MakePiece(color, dir < 4 ? Piece::Rook : Piece::Bishop);
+}
+
+Move Board::moveFromSquares(int from, int to, int promotionType) const {
+	int piece = Square[from];
+	if (promotionType != Piece::None)
+		return Move(from, to, Move::Promotion, promotionType);
+	if (Piece::Type(piece) == Piece::King && to - from == 2)
+		return Move(from, to, Move::KingsideCastle);
+	if (Piece::Type(piece) == Piece::King && from - to == 2)
+		return Move(from, to, Move::QueensideCastle);
+	if (Piece::Type(piece) == Piece::Pawn && (to - from) % 8 != 0 && to == enPassantSquare)
+		return Move(from, to, Move::EnPassant);
+	return Move(from, to);
+}
+
+bool Board::isPseudoLegal(const Move& m) {
+	int from = m.startSquare, to = m.targetSquare;
+	if (from < 0 || from >= 64 || to < 0 || to >= 64 || from == to)
+		return false;
+
+	int piece = Square[from];
+	int target = Square[to];
+	if (piece == Piece::None || !Piece::IsColor(piece, colorToMove))
+		return false;
+	if (target != Piece::None && Piece::IsColor(target, colorToMove))
+		return false;
+
+	int type = Piece::Type(piece);
+	bool castle = m.type == Move::KingsideCastle || m.type == Move::QueensideCastle;
+	if ((type != Piece::Pawn && (m.type == Move::Promotion || m.type == Move::EnPassant)) || (type != Piece::King && castle))
+		return false;
+
+	bool white = colorToMove == Piece::White;
+	switch (type) {
+	case Piece::Pawn: {
+		int forward = white ? 8 : -8;
+		bool promotes = to / 8 == (white ? 7 : 0);
+		if (promotes != (m.type == Move::Promotion))
+			return false;
+		if (promotes && (m.promotionPiece < Piece::Knight || m.promotionPiece > Piece::Queen))
+			return false;
+
+		int fileDelta = to % 8 - from % 8;
+		if (fileDelta == 0) {
+			if (target != Piece::None || m.type == Move::EnPassant)
+				return false;
+			if (to == from + forward)
+				return true;
+			return to == from + 2 * forward && from / 8 == (white ? 1 : 6) && Square[from + forward] == Piece::None;
 		}
-		case Piece::King: {
-			for (int move : PrecomputedMoveData::kingMoves[from]) {
-				if (move == square) return true;
-			}
-			break;
+		if (abs(fileDelta) != 1 || to != from + forward + fileDelta)
+			return false;
+		if (m.type == Move::EnPassant)
+			return to == enPassantSquare;
+		return target != Piece::None;
+	}
+	case Piece::Knight:
+		return find(PrecomputedMoveData::knightMoves[from].begin(), PrecomputedMoveData::knightMoves[from].end(), to)
+			!= PrecomputedMoveData::knightMoves[from].end();
+	case Piece::Bishop:
+	case Piece::Rook:
+	case Piece::Queen: {
+		int dir = directionTo(from, to);
+		if (dir < 0 || (type == Piece::Bishop && dir < 4) || (type == Piece::Rook && dir >= 4))
+			return false;
+		int blocker = firstPiece(*this, from, dir);
+		return blocker == -1 || squareDistance(from, blocker) >= squareDistance(from, to);
+	}
+	case Piece::King: {
+		if (!castle)
+			return squareDistance(from, to) == 1;
+
+		// Same conditions as moveGenerator::GenerateKingMoves
+		bool kingside = m.type == Move::KingsideCastle;
+		int kingStart = white ? 4 : 60;
+		bool kingMoved = white ? whiteKingMoved : blackKingMoved;
+		bool rookMoved = white ? (kingside ? whiteKingsideRookMoved : whiteQueensideRookMoved)
+			: (kingside ? blackKingsideRookMoved : blackQueensideRookMoved);
+		int rookSquare = kingStart + (kingside ? 3 : -4);
+		int step = kingside ? 1 : -1;
+		if (from != kingStart || to != kingStart + 2 * step || kingMoved || rookMoved
+			|| Square[rookSquare] != Piece::MakePiece(colorToMove, Piece::Rook))
+			return false;
+		for (int sq = kingStart + step; sq != rookSquare; sq += step) {
+			if (Square[sq] != Piece::None)
+				return false;
 		}
+		int opponent = Piece::GetOpponentColor(colorToMove);
+		for (int sq = kingStart; sq != kingStart + 3 * step; sq += step) {
+			if (isSquareAttacked(sq, opponent, *this))
+				return false;
 		}
+		return true;
+	}
 	}
+	return false;
+}
 
-	return false; // No attackers found
+bool Board::isLegal(const Move& m) {
+	if (!isPseudoLegal(m))
+		return false;
+
+	int from = m.startSquare, to = m.targetSquare;
+	int piece = Square[from];
+	int opponent = Piece::GetOpponentColor(colorToMove);
+
+	// Castling squares were checked above. Other king moves are tested with the king lifted,
+	// so it cannot shelter behind itself on the line it is checked along.
+	if (Piece::Type(piece) == Piece::King) {
+		if (m.type == Move::KingsideCastle || m.type == Move::QueensideCastle)
+			return true;
+		Square[from] = Piece::None;
+		bool safe = !isSquareAttacked(to, opponent, *this);
+		Square[from] = piece;
+		return safe;
+	}
+
+	int king = findKingSquare(colorToMove);
+
+	// En passant takes two pawns off one rank at once: try it on the squares
+	if (m.type == Move::EnPassant) {
+		int capturedSquare = to + (colorToMove == Piece::White ? -8 : 8);
+		int captured = Square[capturedSquare];
+		Square[from] = Piece::None;
+		Square[capturedSquare] = Piece::None;
+		Square[to] = piece;
+		bool safe = !isSquareAttacked(king, opponent, *this);
+		Square[to] = Piece::None;
+		Square[capturedSquare] = captured;
+		Square[from] = piece;
+		return safe;
+	}
+
+	// A pinned piece stays on the line between its king and the pinner
+	int pinDir = pinDirection(from);
+	if (pinDir >= 0 && directionTo(king, to) != pinDir)
+		return false;
+
+	// Checkers: one must be captured or blocked, two leave only king moves
+	int checker;
+	int checkerCount = findCheckers(king, opponent, checker);
+	if (checkerCount == 0)
+		return true;
+	if (checkerCount > 1)
+		return false;
+
+	if (to == checker)
+		return true;
+	int checkDir = directionTo(king, checker);
+	bool slider = Piece::Type(Square[checker]) != Piece::Pawn && Piece::Type(Square[checker]) != Piece::Knight;
+	return slider && directionTo(king, to) == checkDir && squareDistance(king, to) < squareDistance(king, checker);
+}
+
+int Board::findCheckers(int square, int byColor, int& checker) const {
+	int count = 0;
+	auto found = [&](int from) {
+		if (count++ == 0)
+			checker = from;
+	};
+
+	int pawnFrom = square + (byColor == Piece::White ? -8 : 8);
+	if (pawnFrom >= 0 && pawnFrom < 64) {
+		int pawn = Piece::MakePiece(byColor, Piece::Pawn);
+		if (square % 8 > 0 && Square[pawnFrom - 1] == pawn) found(pawnFrom - 1);
+		if (square % 8 < 7 && Square[pawnFrom + 1] == pawn) found(pawnFrom + 1);
+	}
+	for (int from : PrecomputedMoveData::knightMoves[square]) {
+		if (Square[from] == Piece::MakePiece(byColor, Piece::Knight))
+			found(from);
+	}
+	for (int dir = 0; dir < 8 && count < 2; ++dir) {
+		int from = firstPiece(*this, square, dir);
+		if (from != -1 && slidesAlong(Square[from], byColor, dir))
+			found(from);
+	}
+	return min(count, 2);
 }
 
-void Board::makeMove(Move& m, Board& board) {
+int Board::pinDirection(int square) const {
+	int piece = Square[square];
+	if (piece == Piece::None || Piece::IsKing(piece))
+		return -1;
+	int color = Piece::GetColor(piece);
+	int king = findKingSquare(color);
+	int dir = king == -1 ? -1 : directionTo(king, square);
+	if (dir < 0 || firstPiece(*this, king, dir) != square)
+		return -1;
+	int beyond = firstPiece(*this, square, dir);
+	return beyond != -1 && slidesAlong(Square[beyond], Piece::GetOpponentColor(color), dir) ? dir : -1;
+}
+
+void Board::makeMove(Move& m, Board&) {
+	if (colorToMove == Piece::White)
+		makeMoveFor<Piece::White>(m);
+	else
+		makeMoveFor<Piece::Black>(m);
+}
+
+template<int Us>
+void Board::makeMoveFor(Move& m) {
+	constexpr bool White = Us == Piece::White;
+	constexpr int HomeRank = White ? 0 : 56;
+	constexpr int Forward = White ? 8 : -8;
+
 	int movingPiece = Square[m.startSquare];
 	int captured = Square[m.targetSquare];
 
@@ -214,9 +564,24 @@ void Board::makeMove(Move& m, Board& board) {
 	m.whiteQueensideRookMovedBefore = whiteQueensideRookMoved;
 	m.blackKingsideRookMovedBefore = blackKingsideRookMoved;
 	m.blackQueensideRookMovedBefore = blackQueensideRookMoved;
+	m.halfmoveClockBefore = halfmoveClock;
+	m.zobristKeyBefore = zobristKey;
+
+	// Take the old castling and en passant keys out, the new ones go back in at the end
+	uint64_t key = zobristKey ^ zobristCastlingRights[getCastlingRightsMask()];
+	if (enPassantSquare != -1)
+		key ^= zobristEnPassant[enPassantSquare % 8];
+
+	key ^= zobristTable[m.startSquare][Piece::getIndex(movingPiece)];
+	if (captured != Piece::None) {
+		key ^= zobristTable[m.targetSquare][Piece::getIndex(captured)];
+		pieceCounts[captured]--;
+		pieceTotal--;
+		materialKey -= Material::weight(captured, m.targetSquare);
+	}
 
-	// Inside makeMove()
-	if (m.movedPiece == Piece::Pawn || m.capturedPiece != Piece::None)
+	int movingType = Piece::Type(movingPiece);
+	if (movingType == Piece::Pawn || m.capturedPiece != Piece::None)
 		halfmoveClock = 0;
 	else
 		halfmoveClock++;
@@ -224,8 +589,13 @@ void Board::makeMove(Move& m, Board& board) {
 
 	// Handle en passant
 	if (m.type == Move::EnPassant) {
-		m.enPassantCapturedSquare = (colorToMove == Piece::White) ? m.targetSquare - 8 : m.targetSquare + 8;
+		m.enPassantCapturedSquare = m.targetSquare - Forward;
+		m.capturedPiece = Square[m.enPassantCapturedSquare]; // so undoMove can put the pawn back
+		key ^= zobristTable[m.enPassantCapturedSquare][Piece::getIndex(m.capturedPiece)];
 		Square[m.enPassantCapturedSquare] = Piece::None;
+		pieceCounts[m.capturedPiece]--;
+		pieceTotal--;
+		materialKey -= Material::weight(m.capturedPiece, m.enPassantCapturedSquare);
 	}
 
 	// Handle the move
@@ -234,34 +604,36 @@ void Board::makeMove(Move& m, Board& board) {
 
 	// Handle promotion
 	if (m.type == Move::Promotion && m.promotionPiece != Piece::None) {
-		Square[m.targetSquare] = Piece::MakePiece(Piece::GetColor(movingPiece), m.promotionPiece);
+		Square[m.targetSquare] = m.promotionPiece | Us;
+		pieceCounts[movingPiece]--;
+		pieceCounts[Square[m.targetSquare]]++;
+		materialKey += Material::weight(Square[m.targetSquare], m.targetSquare) - Material::weight(movingPiece, m.startSquare);
 	}
+	key ^= zobristTable[m.targetSquare][Piece::getIndex(Square[m.targetSquare])];
 
 	// Handle castling
-	if (m.type == Move::KingsideCastle) {
-		int rookFrom = (colorToMove == Piece::White) ? 7 : 63;
-		int rookTo = (colorToMove == Piece::White) ? 5 : 61;
-		Square[rookTo] = Square[rookFrom];
-		Square[rookFrom] = Piece::None;
-	}
-	else if (m.type == Move::QueensideCastle) {
-		int rookFrom = (colorToMove == Piece::White) ? 0 : 56;
-		int rookTo = (colorToMove == Piece::White) ? 3 : 59;
+	if (m.type == Move::KingsideCastle || m.type == Move::QueensideCastle) {
+		bool kingside = (m.type == Move::KingsideCastle);
+		int rookFrom = HomeRank + (kingside ? 7 : 0);
+		int rookTo = HomeRank + (kingside ? 5 : 3);
+		key ^= zobristTable[rookFrom][Piece::getIndex(Square[rookFrom])];
+		key ^= zobristTable[rookTo][Piece::getIndex(Square[rookFrom])];
 		Square[rookTo] = Square[rookFrom];
 		Square[rookFrom] = Piece::None;
 	}
 
 	// Update en passant square
-	if (Piece::Type(movingPiece) == Piece::Pawn && abs(m.targetSquare - m.startSquare) == 16) {
-		enPassantSquare = (m.startSquare + m.targetSquare) / 2;
+	if (movingType == Piece::Pawn && m.targetSquare - m.startSquare == 2 * Forward) {
+		enPassantSquare = m.startSquare + Forward;
 	}
 	else {
 		enPassantSquare = -1;
 	}
 
 	// Update castling rights
-	if (Piece::Type(movingPiece) == Piece::King) {
-		if (colorToMove == Piece::White) {
+	if (movingType == Piece::King) {
+		kingSquares[White ? 0 : 1] = m.targetSquare;
+		if (White) {
 			whiteKingMoved = true;
 			castlingRights.whiteKingside = false;
 			castlingRights.whiteQueenside = false;
@@ -272,34 +644,50 @@ void Board::makeMove(Move& m, Board& board) {
 			castlingRights.blackQueenside = false;
 		}
 	}
-	else if (Piece::Type(movingPiece) == Piece::Rook) {
-		if (colorToMove == Piece::White) {
-			if (m.startSquare == 0) {
-				whiteQueensideRookMoved = true;
-				castlingRights.whiteQueenside = false;
-			}
-			if (m.startSquare == 7) {
-				whiteKingsideRookMoved = true;
-				castlingRights.whiteKingside = false;
-			}
+	else if (movingType == Piece::Rook) {
+		if (m.startSquare == HomeRank) {
+			(White ? whiteQueensideRookMoved : blackQueensideRookMoved) = true;
+			(White ? castlingRights.whiteQueenside : castlingRights.blackQueenside) = false;
 		}
-		else {
-			if (m.startSquare == 56) {
-				blackQueensideRookMoved = true;
-				castlingRights.blackQueenside = false;
-			}
-			if (m.startSquare == 63) {
-				blackKingsideRookMoved = true;
-				castlingRights.blackKingside = false;
-			}
+		if (m.startSquare == HomeRank + 7) {
+			(White ? whiteKingsideRookMoved : blackKingsideRookMoved) = true;
+			(White ? castlingRights.whiteKingside : castlingRights.blackKingside) = false;
 		}
 	}
 
+	// A rook captured on its home square takes that castling right with it
+	switch (m.targetSquare) {
+	case 0:  whiteQueensideRookMoved = true; castlingRights.whiteQueenside = false; break;
+	case 7:  whiteKingsideRookMoved = true;  castlingRights.whiteKingside = false;  break;
+	case 56: blackQueensideRookMoved = true; castlingRights.blackQueenside = false; break;
+	case 63: blackKingsideRookMoved = true;  castlingRights.blackKingside = false;  break;
+	}
+
+	key ^= zobristCastlingRights[getCastlingRightsMask()];
+	if (enPassantSquare != -1)
+		key ^= zobristEnPassant[enPassantSquare % 8];
+	zobristKey = key ^ zobristBlackToMove;
+
+	if (!White)
+		fullmoveNumber++;
+
 	// Switch turn
-	colorToMove = Piece::GetOpponentColor(colorToMove);
+	colorToMove = White ? Piece::Black : Piece::White;
 }
 
 void Board::undoMove(const Move& m) {
+	if (Piece::IsColor(m.movedPiece, Piece::White))
+		undoMoveFor<Piece::White>(m);
+	else
+		undoMoveFor<Piece::Black>(m);
+}
+
+// Us is the side that made the move; colorToMove is still the opponent here
+template<int Us>
+void Board::undoMoveFor(const Move& m) {
+	constexpr bool White = Us == Piece::White;
+	constexpr int HomeRank = White ? 0 : 56;
+
 	// Restore the moved piece
 	Square[m.startSquare] = m.movedPiece;
 
@@ -316,21 +704,27 @@ void Board::undoMove(const Move& m) {
 
 	// Undo promotion
 	if (m.promotionPiece != Piece::None) {
-		Square[m.startSquare] = m.movedPiece;  // restore original pawn
+		int promoted = m.promotionPiece | Us;
+		pieceCounts[promoted]--;
+		pieceCounts[m.movedPiece]++;
+		materialKey += Material::weight(m.movedPiece, m.startSquare) - Material::weight(promoted, m.targetSquare);
+	}
+
+	if (m.capturedPiece != Piece::None) {
+		int capturedSquare = (m.type == Move::EnPassant) ? m.enPassantCapturedSquare : m.targetSquare;
+		pieceCounts[m.capturedPiece]++;
+		pieceTotal++;
+		materialKey += Material::weight(m.capturedPiece, capturedSquare);
 	}
 
 	// Undo castling
 	if (m.type == Move::KingsideCastle) {
-		int rookTo = (colorToMove == Piece::White) ? 5 : 61;
-		int rookFrom = (colorToMove == Piece::White) ? 7 : 63;
-		Square[rookFrom] = Square[rookTo];
-		Square[rookTo] = Piece::None;
+		Square[HomeRank + 7] = Square[HomeRank + 5];
+		Square[HomeRank + 5] = Piece::None;
 	}
 	else if (m.type == Move::QueensideCastle) {
-		int rookTo = (colorToMove == Piece::White) ? 3 : 59;
-		int rookFrom = (colorToMove == Piece::White) ? 0 : 56;
-		Square[rookFrom] = Square[rookTo];
-		Square[rookTo] = Piece::None;
+		Square[HomeRank] = Square[HomeRank + 3];
+		Square[HomeRank + 3] = Piece::None;
 	}
 
 	// Restore en passant square
@@ -342,13 +736,29 @@ void Board::undoMove(const Move& m) {
 	castlingRights.blackKingside = m.castlingRightsBeforeMove[2];
 	castlingRights.blackQueenside = m.castlingRightsBeforeMove[3];
 
+	// Restore king/rook movement flags
+	whiteKingMoved = m.whiteKingMovedBefore;
+	blackKingMoved = m.blackKingMovedBefore;
+	whiteKingsideRookMoved = m.whiteKingsideRookMovedBefore;
+	whiteQueensideRookMoved = m.whiteQueensideRookMovedBefore;
+	blackKingsideRookMoved = m.blackKingsideRookMovedBefore;
+	blackQueensideRookMoved = m.blackQueensideRookMovedBefore;
+
+	halfmoveClock = m.halfmoveClockBefore;
+	zobristKey = m.zobristKeyBefore;
+
+	if (Piece::Type(m.movedPiece) == Piece::King)
+		kingSquares[White ? 0 : 1] = m.startSquare;
+	if (!White)
+		fullmoveNumber--;
+
 	// Switch turn back
-	colorToMove = Piece::GetOpponentColor(colorToMove);
+	colorToMove = Us;
 }
 
 
 
-char Board::pieceChar(int piece) {
+char Board::pieceChar(int piece) const {
 	switch (piece) {
 	case Piece::WhitePawn: return 'P';
 	case Piece::WhiteKnight: return 'N';
@@ -375,47 +785,6 @@ void Board::printBoard(const Board& board) {
 }
 
 bool Board::hasInsufficientMaterial() {
-	int whiteBishops = 0, blackBishops = 0;
-	int whiteKnights = 0, blackKnights = 0;
-	int whiteOther = 0, blackOther = 0;
-
-	for (int sq = 0; sq < 64; ++sq) {
-		int p = Piece::getPiece(Square[sq]);
-		if (p == Piece::None || p == Piece::WhiteKing || p == Piece::BlackKing)
-			continue;
-
-		switch (p) {
-		case Piece::WhiteBishop: whiteBishops++; break;
-		case Piece::BlackBishop: blackBishops++; break;
-		case Piece::WhiteKnight: whiteKnights++; break;
-		case Piece::BlackKnight: blackKnights++; break;
-		default:
-			if (Piece::GetColor(p) == Piece::White)
-				whiteOther++;
-			else
-				blackOther++;
-			break;
-		}
-	}
-
-	// Only kings
-	if (whiteBishops == 0 && whiteKnights == 0 && whiteOther == 0 &&
-		blackBishops == 0 && blackKnights == 0 && blackOther == 0)
-		return true;
-
-	// King + bishop or knight vs king
-	if ((whiteBishops == 1 && whiteKnights == 0 && whiteOther == 0 &&
-		blackBishops == 0 && blackKnights == 0 && blackOther == 0) ||
-		(whiteKnights == 1 && whiteBishops == 0 && whiteOther == 0 &&
-			blackBishops == 0 && blackKnights == 0 && blackOther == 0) ||
-		(blackBishops == 1 && blackKnights == 0 && blackOther == 0 &&
-			whiteBishops == 0 && whiteKnights == 0 && whiteOther == 0) ||
-		(blackKnights == 1 && blackBishops == 0 && blackOther == 0 &&
-			whiteBishops == 0 && whiteKnights == 0 && whiteOther == 0))
-		return true;
-
-	// King + bishop vs king + bishop (same color bishop squares)
-	// Optional advanced check if you want to go deeper
-
-	return false;
+	const Material::Entry* entry = Material::probe(materialKey);
+	return entry && entry->insufficient;
 }
\ No newline at end of file
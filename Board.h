@@ -23,22 +23,54 @@ public:
     uint64_t zobristEnPassant[8];
     std::unordered_map<uint64_t, int> repetitionMap;
     int halfmoveClock = 0;
+    int fullmoveNumber = 1;
+    uint64_t zobristKey = 0;     // kept up to date by makeMove/undoMove
+    int kingSquares[2] = { 4, 60 }; // [0] white, [1] black
+    int pieceCounts[16] = {};    // by piece code, kings included; kept up to date by makeMove/undoMove
+    int pieceTotal = 0;
+    uint64_t materialKey = 0;    // see Material
+
+    static constexpr const char* StartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
     CastlingRights castlingRights;
 
     Board();
 
+    bool setFen(const string& fen);
+    bool setFen(const char* fen, size_t length);
+    // Recounts pieceCounts/pieceTotal/materialKey after Square[] was written directly
+    void computeMaterial();
+    string getFen() const;
+
     int getCastlingRightsMask() const;
     void initZobrist();
     uint64_t computeZobristHash(const Board& board) const;
-    void recordPosition(Board& board);
-    bool isThreefoldRepetition(Board& board);
+    void recordPosition();
+    bool isThreefoldRepetition();
     static bool IsPathClear(int from, int to, const Board& board);
     int findKingSquare(int color) const;
     bool isSquareAttacked(int square, int byColor, const Board& board);
+    // Move with its type worked out from the board (castling, en passant, promotion), for
+    // moves that arrive as squares: UCI text, packed hash moves, GUI clicks
+    Move moveFromSquares(int from, int to, int promotionType = Piece::None) const;
+    // Could moveGenerator::GenerateMoves produce this move here?
+    bool isPseudoLegal(const Move& m);
+    // Pseudo-legal and leaves the mover's king safe; decided from the checkers and pins
+    // around the king, without playing the move or generating any others
+    bool isLegal(const Move& m);
+    // Pieces of byColor attacking the square, counted up to two; the first one's square in 'checker'
+    int findCheckers(int square, int byColor, int& checker) const;
+    // DirectionOffsets index of the line along which the piece on square is pinned to its king, -1 if free
+    int pinDirection(int square) const;
     void makeMove(Move& m, Board& board);
     void undoMove(const Move& m);
-    char pieceChar(int piece);
+    char pieceChar(int piece) const;
     void printBoard(const Board& board);
     bool hasInsufficientMaterial();
+
+private:
+    // makeMove/undoMove for one mover (Piece::White or Piece::Black), so its home rank and
+    // pawn direction are constants; the public ones pick the instance
+    template<int Us> void makeMoveFor(Move& m);
+    template<int Us> void undoMoveFor(const Move& m);
 };
\ No newline at end of file
@@ -25,15 +25,15 @@ void BoardUI::selectedSquareHighLight(SDL_Renderer* renderer, int selectedSquare
 	}
 }
 
-void BoardUI::highLightLegalMoves(SDL_Renderer* renderer, int selectedSquare, const vector<Move>& legalMoves) {
-	for (const Move& move : legalMoves) {
-		if (move.startSquare == selectedSquare) {
-			int file = move.targetSquare % 8;
-			int rank = 7 - (move.targetSquare / 8);
-			int centerX = file * SQUARE_SIZE + SQUARE_SIZE / 2;
-			int centerY = rank * SQUARE_SIZE + SQUARE_SIZE / 2;
-			Renderer::drawCircle(renderer, centerX, centerY, SQUARE_SIZE / 6, SUGGESTIONCOLOR);
-		}
+void BoardUI::highLightLegalMoves(SDL_Renderer* renderer, uint64_t targets) {
+	for (int square = 0; square < 64; square++) {
+		if (!(targets & (1ULL << square)))
+			continue;
+		int file = square % 8;
+		int rank = 7 - (square / 8);
+		int centerX = file * SQUARE_SIZE + SQUARE_SIZE / 2;
+		int centerY = rank * SQUARE_SIZE + SQUARE_SIZE / 2;
+		Renderer::drawCircle(renderer, centerX, centerY, SQUARE_SIZE / 6, SUGGESTIONCOLOR);
 	}
 }
 
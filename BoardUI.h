@@ -16,7 +16,7 @@ class BoardUI {
 		BoardUI(Board* b);
 		void draw(SDL_Renderer* renderer, int selectedSquare = -1, const vector<Move>& legalMoves = {});
 		void selectedSquareHighLight(SDL_Renderer* renderer, int selectedSquare = -1);
-		void highLightLegalMoves(SDL_Renderer* renderer, int selectedSquare = -1, const vector<Move>& legalMoves = {});
+		void highLightLegalMoves(SDL_Renderer* renderer, uint64_t targets); // moveGenerator::TargetMask
 		void loadTextures(SDL_Renderer* renderer);
 		SDL_Texture* loadPieceTexture(SDL_Renderer* renderer, const string& filePath);
 		void renderPieces(SDL_Renderer* renderer);
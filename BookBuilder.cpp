@@ -0,0 +1,100 @@
+#include "BookBuilder.h"
+#include <cstdio>
+
+using namespace std;
+
+BookBuilder::BookBuilder(const string& path, const Options& opts)
+	: outputPath(path), options(opts), sorter(path), shards(ShardCount) {
+	// An unordered_map entry costs about 48 bytes with its node and bucket
+	shardLimit = max<size_t>(1024, options.memoryMb * 1024 * 1024 / 48 / ShardCount);
+}
+
+void BookBuilder::add(const Board& board, const Move& move, GameStore::Result result) {
+	if (result == GameStore::Unknown)
+		return;
+
+	Slot slot = { PolyglotBook::key(board), PolyglotBook::encodeMove(move) };
+	bool whiteMoved = (board.colorToMove == Piece::White);
+	uint32_t points = 1;
+	if (result != GameStore::Draw)
+		points = ((result == GameStore::WhiteWins) == whiteMoved) ? 2 : 0;
+
+	Shard& shard = shards[slot.key >> 58];
+	unordered_map<Slot, Counts, SlotHash> full;
+	{
+		lock_guard<mutex> lock(shard.lock);
+		Counts& counts = shard.counts[slot];
+		counts.games++;
+		counts.points += points;
+		if (shard.counts.size() >= shardLimit)
+			full.swap(shard.counts);
+	}
+	added++;
+
+	// Sorted and written outside the lock so other threads can keep filling the shard
+	if (!full.empty() && !spill(full))
+		failed = true;
+}
+
+bool BookBuilder::spill(unordered_map<Slot, Counts, SlotHash>& counts) {
+	vector<Record> records;
+	records.reserve(counts.size());
+	for (const auto& entry : counts) {
+		Record r = {};
+		r.key = entry.first.key;
+		r.move = entry.first.move;
+		r.games = entry.second.games;
+		r.points = entry.second.points;
+		records.push_back(r);
+	}
+	counts.clear();
+	return sorter.spill(records);
+}
+
+bool BookBuilder::finish() {
+	for (Shard& shard : shards) {
+		if (!spill(shard.counts))
+			failed = true;
+	}
+	if (failed)
+		return false;
+
+	FILE* out = fopen(outputPath.c_str(), "wb");
+	if (!out)
+		return false;
+
+	// Moves of one position arrive together; write them best first
+	vector<Record> group;
+	auto writeGroup = [&]() {
+		sort(group.begin(), group.end(), [](const Record& a, const Record& b) {
+			return a.points > b.points;
+		});
+
+		// Weights are 16 bits, so a position with more points than that is scaled down
+		uint32_t top = group.empty() ? 0 : group[0].points;
+		for (const Record& r : group) {
+			uint64_t weight = (top > 0xFFFF) ? uint64_t(r.points) * 0xFFFF / top : r.points;
+			if (weight == 0)
+				continue;
+
+			PolyglotBook::Entry entry = { r.key, r.move, static_cast<uint16_t>(weight), 0 };
+			uint8_t bytes[PolyglotBook::EntrySize];
+			PolyglotBook::writeEntry(entry, bytes);
+			fwrite(bytes, sizeof(bytes), 1, out);
+			written++;
+		}
+		group.clear();
+	};
+
+	bool ok = sorter.merge([&](const Record& r) {
+		if (!group.empty() && group[0].key != r.key)
+			writeGroup();
+		if (r.games >= options.minGames && uint64_t(r.points) * 50 >= uint64_t(options.minScore) * r.games)
+			group.push_back(r);
+	});
+	writeGroup();
+
+	ok = ok && ferror(out) == 0;
+	fclose(out);
+	return ok;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Board.h"
+#include "GameStore.h"
+#include "PolyglotBook.h"
+#include "ExternalSorter.h"
+#include "useFullStuff.h"
+#include <mutex>
+#include <atomic>
+
+using namespace std;
+
+// Collects (position, move) statistics from many games and writes them as a Polyglot book.
+// Counts go into hash maps split into shards with their own locks, so callers on many
+// threads rarely wait on each other. A shard that outgrows its share of the memory budget
+// is sorted and spilled to a run file; finish() merges the runs, so the collection can be
+// far larger than RAM.
+class BookBuilder {
+public:
+	struct Options {
+		uint32_t minGames = 3;  // a move must have been played this often
+		int minScore = 0;       // and scored at least this many percent for the mover
+		size_t memoryMb = 1024;
+	};
+
+	BookBuilder(const string& outputPath, const Options& options);
+
+	// Counts move as played from board in a game that ended with result (thread safe)
+	void add(const Board& board, const Move& move, GameStore::Result result);
+
+	// Merges everything collected and writes the sorted book
+	bool finish();
+
+	uint64_t positionsAdded() const { return added; }
+	uint64_t entriesWritten() const { return written; }
+
+private:
+	struct Record {
+		uint64_t key;
+		uint16_t move;
+		uint16_t reserved;
+		uint32_t games;
+		uint32_t points;        // 2 per win and 1 per draw, for the side that made the move
+		uint32_t padding;
+	};
+
+	struct RecordLess {
+		bool operator()(const Record& a, const Record& b) const {
+			return a.key != b.key ? a.key < b.key : a.move < b.move;
+		}
+	};
+	struct RecordSame {
+		bool operator()(const Record& a, const Record& b) const {
+			return a.key == b.key && a.move == b.move;
+		}
+	};
+	struct RecordCombine {
+		void operator()(Record& into, const Record& from) const {
+			into.games += from.games;
+			into.points += from.points;
+		}
+	};
+
+	using Sorter = ExternalSorter<Record, RecordLess, RecordSame, RecordCombine>;
+
+	struct Slot {
+		uint64_t key;
+		uint16_t move;
+		bool operator==(const Slot& other) const { return key == other.key && move == other.move; }
+	};
+	struct SlotHash {
+		size_t operator()(const Slot& slot) const {
+			return static_cast<size_t>(slot.key ^ (slot.move * 0x9E3779B97F4A7C15ULL));
+		}
+	};
+	struct Counts {
+		uint32_t games = 0;
+		uint32_t points = 0;
+	};
+
+	struct Shard {
+		mutex lock;
+		unordered_map<Slot, Counts, SlotHash> counts;
+	};
+
+	static const int ShardCount = 64;
+
+	string outputPath;
+	Options options;
+	Sorter sorter;
+	vector<Shard> shards;
+	size_t shardLimit;
+	atomic<uint64_t> added{ 0 };
+	uint64_t written = 0;
+	atomic<bool> failed{ false };
+
+	bool spill(unordered_map<Slot, Counts, SlotHash>& counts);
+};
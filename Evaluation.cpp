@@ -0,0 +1,45 @@
+#include "Evaluation.h"
+#include "Material.h"
+
+using namespace std;
+
+int Evaluation::pieceSquareValue(int piece, int square) {
+	int index = Piece::IsWhite(piece) ? (square ^ 56) : square;
+
+	switch (Piece::Type(piece)) {
+	case Piece::Pawn:   return EvaluationParameters::PawnTable[index];
+	case Piece::Knight: return EvaluationParameters::KnightTable[index];
+	case Piece::Bishop: return EvaluationParameters::BishopTable[index];
+	case Piece::Rook:   return EvaluationParameters::RookTable[index];
+	case Piece::Queen:  return EvaluationParameters::QueenTable[index];
+	case Piece::King:   return EvaluationParameters::KingTable[index];
+	default:            return 0;
+	}
+}
+
+int Evaluation::evaluate(const Board& board) {
+	// Known endings are scored without looking at the squares
+	const Material::Entry* material = (board.pieceTotal <= 6) ? Material::probe(board.materialKey) : nullptr;
+	if (material && material->insufficient)
+		return 0;
+	if (material && material->evaluate) {
+		int strongScore = material->evaluate(board, material->strongColor);
+		return (board.colorToMove == material->strongColor) ? strongScore : -strongScore;
+	}
+
+	int score = 0; // white's point of view
+
+	for (int sq = 0; sq < 64; ++sq) {
+		int piece = board.Square[sq];
+		if (piece == Piece::None)
+			continue;
+
+		int value = PieceValues[Piece::Type(piece)] + pieceSquareValue(piece, sq);
+		score += Piece::IsWhite(piece) ? value : -value;
+	}
+
+	if (material && material->drawish)
+		score /= 4;
+
+	return (board.colorToMove == Piece::White) ? score : -score;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Board.h"
+#include "EvaluationParameters.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+class Evaluation {
+public:
+	static constexpr array<int, 7> PieceValues = EvaluationParameters::PieceValues;
+
+	// Base score of a position the engine knows is won (K+P v K from the bitbase)
+	static const int KnownWin = 10000;
+
+	// Static score in centipawns from the side to move's point of view
+	static int evaluate(const Board& board);
+	static int pieceSquareValue(int piece, int square);
+};
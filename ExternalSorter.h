@@ -0,0 +1,128 @@
+#pragma once
+
+#include "useFullStuff.h"
+#include <cstdio>
+#include <mutex>
+#include <queue>
+#include <functional>
+
+using namespace std;
+
+// Sort-and-aggregate for more records than fit in memory. Callers fill their own buffer
+// and hand it to spill() when it is full: the buffer is sorted, equal records are combined
+// and the result goes to a run file. merge() then streams all runs back in order, combining
+// equal records across runs. spill() may be called from several threads at once.
+//
+// Record must be trivially copyable. Less orders records, Same says two records are the
+// same item and Combine folds the second into the first.
+template <class Record, class Less, class Same, class Combine>
+class ExternalSorter {
+public:
+	ExternalSorter(const string& tempPrefix) : prefix(tempPrefix) {}
+
+	~ExternalSorter() {
+		for (const string& path : runs)
+			remove(path.c_str());
+	}
+
+	static void sortAndCombine(vector<Record>& records) {
+		sort(records.begin(), records.end(), Less());
+
+		size_t out = 0;
+		for (size_t i = 0; i < records.size(); ++i) {
+			if (out > 0 && Same()(records[out - 1], records[i]))
+				Combine()(records[out - 1], records[i]);
+			else
+				records[out++] = records[i];
+		}
+		records.resize(out);
+	}
+
+	// Sorts, combines and writes records as one run; records is left empty
+	bool spill(vector<Record>& records) {
+		if (records.empty())
+			return true;
+		sortAndCombine(records);
+
+		string path;
+		{
+			lock_guard<mutex> lock(runMutex);
+			path = prefix + ".run" + to_string(runs.size());
+			runs.push_back(path);
+		}
+
+		FILE* f = fopen(path.c_str(), "wb");
+		if (!f)
+			return false;
+		bool ok = fwrite(records.data(), sizeof(Record), records.size(), f) == records.size();
+		fclose(f);
+		records.clear();
+		return ok;
+	}
+
+	// k-way merge of every run; onRecord sees each distinct record once, in order
+	bool merge(const function<void(const Record&)>& onRecord) {
+		struct Run {
+			FILE* file = nullptr;
+			vector<Record> buffer;
+			size_t pos = 0;
+
+			bool refill() {
+				buffer.resize(ReadBatch);
+				buffer.resize(fread(buffer.data(), sizeof(Record), ReadBatch, file));
+				pos = 0;
+				return !buffer.empty();
+			}
+		};
+
+		vector<Run> open(runs.size());
+		for (size_t i = 0; i < runs.size(); ++i) {
+			open[i].file = fopen(runs[i].c_str(), "rb");
+			if (!open[i].file)
+				return false;
+		}
+
+		auto greater = [&](size_t a, size_t b) {
+			return Less()(open[b].buffer[open[b].pos], open[a].buffer[open[a].pos]);
+		};
+		priority_queue<size_t, vector<size_t>, decltype(greater)> heap(greater);
+		for (size_t i = 0; i < open.size(); ++i) {
+			if (open[i].refill())
+				heap.push(i);
+		}
+
+		bool havePending = false;
+		Record pending{};
+		while (!heap.empty()) {
+			size_t i = heap.top();
+			heap.pop();
+			const Record& r = open[i].buffer[open[i].pos];
+
+			if (havePending && Same()(pending, r)) {
+				Combine()(pending, r);
+			}
+			else {
+				if (havePending)
+					onRecord(pending);
+				pending = r;
+				havePending = true;
+			}
+
+			if (++open[i].pos < open[i].buffer.size() || open[i].refill())
+				heap.push(i);
+		}
+		if (havePending)
+			onRecord(pending);
+
+		for (Run& run : open)
+			fclose(run.file);
+		return true;
+	}
+
+private:
+	static const size_t ReadBatch = 1 << 14;
+
+	string prefix;
+	mutex runMutex;
+	vector<string> runs;
+};
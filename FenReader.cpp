@@ -0,0 +1,78 @@
+#include "FenReader.h"
+#include <cstring>
+
+using namespace std;
+
+FenReader::FenReader(const string& path, size_t bufferSize) : buffer(max<size_t>(bufferSize, 256)) {
+	file = fopen(path.c_str(), "rb");
+	eof = (file == nullptr);
+}
+
+FenReader::~FenReader() {
+	if (file)
+		fclose(file);
+}
+
+bool FenReader::isOpen() const {
+	return file != nullptr;
+}
+
+size_t FenReader::linesRead() const {
+	return lineCount;
+}
+
+bool FenReader::refill() {
+	if (eof)
+		return false;
+
+	// Slide the partial line to the front and fill up the rest
+	size_t remaining = end - begin;
+	if (remaining == buffer.size())
+		buffer.resize(buffer.size() * 2); // a single line longer than the buffer
+	memmove(buffer.data(), buffer.data() + begin, remaining);
+	begin = 0;
+	end = remaining;
+
+	size_t got = fread(buffer.data() + end, 1, buffer.size() - end, file);
+	end += got;
+	if (got == 0)
+		eof = true;
+	return got > 0;
+}
+
+bool FenReader::nextLine(const char*& line, size_t& length) {
+	while (true) {
+		const char* start = buffer.data() + begin;
+		const char* newline = static_cast<const char*>(memchr(start, '\n', end - begin));
+
+		if (newline == nullptr && refill())
+			continue;
+
+		size_t lineLength = newline ? static_cast<size_t>(newline - start) : end - begin;
+		if (lineLength == 0 && newline == nullptr)
+			return false; // nothing left
+
+		begin += lineLength + (newline ? 1 : 0);
+		lineCount++;
+
+		while (lineLength > 0 && (start[lineLength - 1] == '\r' || start[lineLength - 1] == ' '))
+			lineLength--;
+		if (lineLength == 0)
+			continue;
+
+		line = start;
+		length = lineLength;
+		return true;
+	}
+}
+
+bool FenReader::next(Board& board) {
+	const char* line;
+	size_t length;
+
+	while (nextLine(line, length)) {
+		if (board.setFen(line, length))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Board.h"
+#include "useFullStuff.h"
+#include <cstdio>
+
+using namespace std;
+
+// Streams FEN/EPD lines out of a file through one fixed buffer. Lines are handed out as
+// views into that buffer, so reading millions of positions does no per-line allocation.
+class FenReader {
+public:
+	FenReader(const string& path, size_t bufferSize = 1 << 20);
+	~FenReader();
+
+	bool isOpen() const;
+
+	// View of the next non-empty line, valid until the following call
+	bool nextLine(const char*& line, size_t& length);
+	// Loads the next valid position into board, skipping lines that don't parse
+	bool next(Board& board);
+
+	size_t linesRead() const;
+
+private:
+	FILE* file = nullptr;
+	vector<char> buffer;
+	size_t begin = 0;   // start of unread data in buffer
+	size_t end = 0;     // end of valid data in buffer
+	bool eof = false;
+	size_t lineCount = 0;
+
+	bool refill();
+};
@@ -0,0 +1,193 @@
+#include "GameStore.h"
+#include <cstring>
+
+using namespace std;
+
+static const char Magic[8] = { 'C', 'W', 'C', 'G', 'A', 'M', 'E', 'S' };
+
+static int moveKey(const Move& m) {
+	int promo = (m.type == Move::Promotion) ? m.promotionPiece : 0;
+	return m.startSquare | (m.targetSquare << 6) | (promo << 12);
+}
+
+GameStore::GameStore(const string& path) : file(path) {
+	if (!file.isOpen() || file.size() < sizeof(FileHeader))
+		return;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file.data());
+	if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version)
+		return;
+	if (header->indexOffset + header->gameCount * sizeof(uint64_t) > file.size())
+		return;
+
+	fileHeader = header;
+	offsets = reinterpret_cast<const uint64_t*>(file.data() + header->indexOffset);
+}
+
+bool GameStore::isOpen() const {
+	return fileHeader != nullptr;
+}
+
+size_t GameStore::gameCount() const {
+	return fileHeader ? static_cast<size_t>(fileHeader->gameCount) : 0;
+}
+
+GameStore::GameView GameStore::game(size_t index) const {
+	GameView view;
+	if (index >= gameCount())
+		return view;
+
+	const char* base = file.data() + offsets[index];
+	view.header = reinterpret_cast<const GameHeader*>(base);
+	view.fen = string_view(base + sizeof(GameHeader), view.header->fenLength);
+	view.moves = reinterpret_cast<const uint8_t*>(base + sizeof(GameHeader) + view.header->fenLength);
+	return view;
+}
+
+bool GameStore::startPosition(const GameView& view, Board& board) {
+	if (view.fen.empty())
+		return board.setFen(Board::StartFen);
+	return board.setFen(view.fen.data(), view.fen.size());
+}
+
+bool GameStore::replay(size_t index, Board& board, vector<Move>& moves, moveGenerator& generator) const {
+	moves.clear();
+	GameView view = game(index);
+	if (!view.header || !startPosition(view, board))
+		return false;
+
+	for (int ply = 0; ply < view.header->plyCount; ++ply) {
+		Move m(0, 0);
+		if (!decodeMove(board, view.moves[ply], generator, m))
+			return false;
+		board.makeMove(m, board);
+		moves.push_back(m);
+	}
+	return true;
+}
+
+bool GameStore::decodeMove(Board& board, uint8_t code, moveGenerator& generator, Move& out) {
+	vector<Move> legal = generator.GenerateLegalMoves(&board);
+	sortLegalMoves(legal);
+	if (code >= legal.size())
+		return false;
+	out = legal[code];
+	return true;
+}
+
+GameStore::Result GameStore::resultFromString(string_view result) {
+	if (result == "1-0") return WhiteWins;
+	if (result == "0-1") return BlackWins;
+	if (result == "1/2-1/2") return Draw;
+	return Unknown;
+}
+
+void GameStore::sortLegalMoves(vector<Move>& moves) {
+	sort(moves.begin(), moves.end(), [](const Move& a, const Move& b) {
+		return moveKey(a) < moveKey(b);
+	});
+}
+
+bool GameStore::encodeGame(const Board& start, const vector<Move>& moves, Result result,
+	int whiteElo, int blackElo, moveGenerator& generator, vector<uint8_t>& out) {
+	out.clear();
+	if (moves.size() > 0xFFFF)
+		return false;
+
+	string fen;
+	Board board = start;
+	if (board.getFen() != Board::StartFen)
+		fen = board.getFen();
+
+	GameHeader header = {};
+	header.plyCount = static_cast<uint16_t>(moves.size());
+	header.result = result;
+	header.whiteElo = static_cast<uint16_t>(max(0, whiteElo));
+	header.blackElo = static_cast<uint16_t>(max(0, blackElo));
+	header.fenLength = static_cast<uint16_t>(fen.size());
+
+	out.resize(sizeof(GameHeader));
+	memcpy(out.data(), &header, sizeof(GameHeader));
+	out.insert(out.end(), fen.begin(), fen.end());
+
+	for (const Move& played : moves) {
+		vector<Move> legal = generator.GenerateLegalMoves(&board);
+		sortLegalMoves(legal);
+
+		int key = moveKey(played);
+		auto it = lower_bound(legal.begin(), legal.end(), key, [](const Move& m, int k) {
+			return moveKey(m) < k;
+		});
+		if (it == legal.end() || moveKey(*it) != key)
+			return false;
+
+		out.push_back(static_cast<uint8_t>(it - legal.begin()));
+		Move m = *it;
+		board.makeMove(m, board);
+	}
+
+	// Keep the next GameHeader 2-byte aligned
+	if (out.size() % 2)
+		out.push_back(0);
+	return true;
+}
+
+GameStoreWriter::GameStoreWriter(const string& path) {
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+		return;
+
+	// Placeholder, rewritten with the real counts by finish()
+	GameStore::FileHeader header = {};
+	fwrite(&header, sizeof(header), 1, file);
+	position = sizeof(header);
+}
+
+GameStoreWriter::~GameStoreWriter() {
+	if (file)
+		finish();
+}
+
+bool GameStoreWriter::isOpen() const {
+	return file != nullptr;
+}
+
+size_t GameStoreWriter::gameCount() const {
+	return offsets.size();
+}
+
+void GameStoreWriter::append(const vector<uint8_t>& encodedGame) {
+	if (!file || encodedGame.empty())
+		return;
+
+	lock_guard<mutex> lock(writeMutex);
+	offsets.push_back(position);
+	fwrite(encodedGame.data(), 1, encodedGame.size(), file);
+	position += encodedGame.size();
+}
+
+bool GameStoreWriter::finish() {
+	if (!file)
+		return false;
+
+	// 8-byte aligned offset index at the end of the file
+	static const uint8_t padding[8] = {};
+	size_t pad = (8 - position % 8) % 8;
+	fwrite(padding, 1, pad, file);
+	position += pad;
+
+	GameStore::FileHeader header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = GameStore::Version;
+	header.gameCount = offsets.size();
+	header.indexOffset = position;
+
+	fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file);
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	file = nullptr;
+	return ok;
+}
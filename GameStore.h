@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Board.h"
+#include "moveGenerator.h"
+#include "MappedFile.h"
+#include "useFullStuff.h"
+#include <cstdio>
+#include <mutex>
+#include <string_view>
+
+using namespace std;
+
+// Binary game archive. Every move is stored as one byte: its index in the legal move list
+// sorted by (from, to, promotion), which does not depend on moveGenerator's output order.
+//
+// File layout (little endian):
+//   FileHeader
+//   games, each: GameHeader, fenLength bytes of start FEN (if any), plyCount move bytes
+//   index: gameCount uint64 offsets of the GameHeaders
+class GameStore {
+public:
+	enum Result : uint8_t {
+		WhiteWins = 0,
+		BlackWins = 1,
+		Draw = 2,
+		Unknown = 3
+	};
+
+	struct FileHeader {
+		char magic[8];          // "CWCGAMES"
+		uint32_t version;
+		uint32_t reserved;
+		uint64_t gameCount;
+		uint64_t indexOffset;
+	};
+
+	struct GameHeader {
+		uint16_t plyCount;
+		uint8_t result;
+		uint8_t flags;
+		uint16_t whiteElo;
+		uint16_t blackElo;
+		uint16_t fenLength;     // 0 = standard start position
+		uint16_t reserved;
+	};
+
+	static_assert(sizeof(GameHeader) == 12, "GameHeader is part of the file format");
+
+	struct GameView {
+		const GameHeader* header = nullptr;
+		string_view fen;
+		const uint8_t* moves = nullptr;
+	};
+
+	static const uint32_t Version = 1;
+
+	explicit GameStore(const string& path);
+
+	bool isOpen() const;
+	size_t gameCount() const;
+	GameView game(size_t index) const;   // O(1) through the offset index, no copying
+
+	// Replays a stored game; moves come back fully filled in by makeMove
+	bool replay(size_t index, Board& board, vector<Move>& moves, moveGenerator& generator) const;
+	// Board positioned at the start of the game
+	static bool startPosition(const GameView& view, Board& board);
+	// The move a stored byte stands for in the current position (not played)
+	static bool decodeMove(Board& board, uint8_t code, moveGenerator& generator, Move& out);
+
+	static Result resultFromString(string_view result);
+	static void sortLegalMoves(vector<Move>& moves);
+	// Encodes one game (header, FEN, move bytes) into out. Fails on an illegal move.
+	static bool encodeGame(const Board& start, const vector<Move>& moves, Result result,
+		int whiteElo, int blackElo, moveGenerator& generator, vector<uint8_t>& out);
+
+private:
+	MappedFile file;
+	const FileHeader* fileHeader = nullptr;
+	const uint64_t* offsets = nullptr;
+};
+
+// Streams encoded games to disk and writes the offset index on finish().
+// append() is thread safe so PgnReader callbacks can encode in parallel.
+class GameStoreWriter {
+public:
+	explicit GameStoreWriter(const string& path);
+	~GameStoreWriter();
+
+	bool isOpen() const;
+	void append(const vector<uint8_t>& encodedGame);
+	bool finish();
+
+	size_t gameCount() const;
+
+private:
+	FILE* file = nullptr;
+	mutex writeMutex;
+	vector<uint64_t> offsets;
+	uint64_t position = 0;
+};
@@ -0,0 +1,169 @@
+#include "KpkBitbase.h"
+
+using namespace std;
+
+namespace {
+
+	// Position states while the table is being built
+	enum : uint8_t { Invalid = 0, Unknown = 1, Draw = 2, Win = 4 };
+
+	constexpr int fileOf(int square) { return square % 8; }
+	constexpr int rankOf(int square) { return square / 8; }
+
+	constexpr int distance(int a, int b) {
+		int files = fileOf(a) > fileOf(b) ? fileOf(a) - fileOf(b) : fileOf(b) - fileOf(a);
+		int ranks = rankOf(a) > rankOf(b) ? rankOf(a) - rankOf(b) : rankOf(b) - rankOf(a);
+		return files > ranks ? files : ranks;
+	}
+
+	constexpr bool pawnAttacks(int pawn, int square) {
+		return rankOf(square) == rankOf(pawn) + 1 && (fileOf(square) - fileOf(pawn) == 1 || fileOf(pawn) - fileOf(square) == 1);
+	}
+
+	// Squares a king on square can step to, written into targets; returns how many
+	constexpr int kingSteps(int square, int* targets) {
+		int count = 0;
+		for (int dr = -1; dr <= 1; ++dr) {
+			for (int df = -1; df <= 1; ++df) {
+				int file = fileOf(square) + df, rank = rankOf(square) + dr;
+				if ((df != 0 || dr != 0) && file >= 0 && file < 8 && rank >= 0 && rank < 8)
+					targets[count++] = rank * 8 + file;
+			}
+		}
+		return count;
+	}
+
+	// pawn on files a-d and ranks 2-7
+	constexpr int indexOf(bool whiteToMove, int blackKing, int whiteKing, int pawn) {
+		return (whiteToMove ? 0 : 1) + 2 * blackKing + 128 * whiteKing + 8192 * (fileOf(pawn) + 4 * (rankOf(pawn) - 1));
+	}
+
+	constexpr uint8_t initialState(bool whiteToMove, int blackKing, int whiteKing, int pawn) {
+		if (distance(whiteKing, blackKing) <= 1 || whiteKing == pawn || blackKing == pawn)
+			return Invalid;
+		if (whiteToMove && pawnAttacks(pawn, blackKing))
+			return Invalid;
+
+		// A pawn on the seventh that can promote safely wins
+		int promotion = pawn + 8;
+		if (whiteToMove && rankOf(pawn) == 6 && whiteKing != promotion && blackKing != promotion
+			&& (distance(blackKing, promotion) > 1 || distance(whiteKing, promotion) == 1))
+			return Win;
+
+		if (!whiteToMove) {
+			// The pawn falls, or black is stalemated
+			if (distance(blackKing, pawn) == 1 && distance(whiteKing, pawn) > 1)
+				return Draw;
+			int targets[8] = {};
+			int count = kingSteps(blackKing, targets);
+			bool canMove = false;
+			for (int i = 0; i < count; ++i) {
+				int to = targets[i];
+				if (distance(whiteKing, to) > 1 && !pawnAttacks(pawn, to) && to != pawn)
+					canMove = true;
+			}
+			if (!canMove)
+				return Draw;
+		}
+		return Unknown;
+	}
+
+	// Win if white can reach a win (or black can't avoid one), Draw if the reverse, else Unknown
+	constexpr uint8_t classify(const uint8_t* states, bool whiteToMove, int blackKing, int whiteKing, int pawn) {
+		uint8_t seen = Invalid;
+		int targets[8] = {};
+		if (whiteToMove) {
+			int count = kingSteps(whiteKing, targets);
+			for (int i = 0; i < count; ++i) {
+				int to = targets[i];
+				if (distance(blackKing, to) > 1 && to != pawn)
+					seen |= states[indexOf(false, blackKing, to, pawn)];
+			}
+			if (rankOf(pawn) < 6 && pawn + 8 != whiteKing && pawn + 8 != blackKing) {
+				seen |= states[indexOf(false, blackKing, whiteKing, pawn + 8)];
+				if (rankOf(pawn) == 1 && pawn + 16 != whiteKing && pawn + 16 != blackKing)
+					seen |= states[indexOf(false, blackKing, whiteKing, pawn + 16)];
+			}
+			return (seen & Win) ? Win : (seen & Unknown) ? Unknown : Draw;
+		}
+
+		int count = kingSteps(blackKing, targets);
+		for (int i = 0; i < count; ++i) {
+			int to = targets[i];
+			if (distance(whiteKing, to) > 1 && !pawnAttacks(pawn, to) && to != pawn)
+				seen |= states[indexOf(true, to, whiteKing, pawn)];
+		}
+		return (seen & Draw) ? Draw : (seen & Unknown) ? Unknown : Win;
+	}
+
+	struct Bits {
+		uint64_t words[KpkBitbase::Positions / 64] = {};
+	};
+
+	Bits build() {
+		vector<uint8_t> states(KpkBitbase::Positions);
+		for (int i = 0; i < KpkBitbase::Positions; ++i) {
+			bool whiteToMove = (i & 1) == 0;
+			int blackKing = (i >> 1) & 63;
+			int whiteKing = (i >> 7) & 63;
+			int pawnIndex = i >> 13;
+			int pawn = 8 * (pawnIndex / 4 + 1) + pawnIndex % 4;
+			states[i] = initialState(whiteToMove, blackKing, whiteKing, pawn);
+		}
+
+		// Iterate until nothing changes; what is still unknown is a draw
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (int i = 0; i < KpkBitbase::Positions; ++i) {
+				if (states[i] != Unknown)
+					continue;
+				int pawnIndex = i >> 13;
+				int pawn = 8 * (pawnIndex / 4 + 1) + pawnIndex % 4;
+				states[i] = classify(states.data(), (i & 1) == 0, (i >> 1) & 63, (i >> 7) & 63, pawn);
+				changed |= states[i] != Unknown;
+			}
+		}
+
+		Bits bits;
+		for (int i = 0; i < KpkBitbase::Positions; ++i) {
+			if (states[i] == Win)
+				bits.words[i / 64] |= uint64_t(1) << (i % 64);
+		}
+		return bits;
+	}
+
+	// Built once at startup: a few million steps, more than compilers allow a constant expression
+	const Bits Table = build();
+}
+
+bool KpkBitbase::probe(int whiteKing, int pawn, int blackKing, bool whiteToMove) {
+	if (fileOf(pawn) > 3) {
+		whiteKing ^= 7;
+		pawn ^= 7;
+		blackKing ^= 7;
+	}
+	int i = indexOf(whiteToMove, blackKing, whiteKing, pawn);
+	return (Table.words[i / 64] >> (i % 64)) & 1;
+}
+
+bool KpkBitbase::probe(const Board& board, bool& pawnSideWins) {
+	int pawn = -1;
+	for (int square = 0; square < 64; ++square) {
+		int type = Piece::Type(board.Square[square]);
+		if (type == Piece::None || type == Piece::King)
+			continue;
+		if (type != Piece::Pawn || pawn != -1)
+			return false;
+		pawn = square;
+	}
+	if (pawn == -1)
+		return false;
+
+	// Seen from the pawn's side as white
+	bool white = Piece::IsWhite(board.Square[pawn]);
+	int flip = white ? 0 : 56;
+	int strongKing = board.kingSquares[white ? 0 : 1] ^ flip;
+	int weakKing = board.kingSquares[white ? 1 : 0] ^ flip;
+	pawnSideWins = probe(strongKing, pawn ^ flip, weakKing, board.colorToMove == Piece::GetColor(board.Square[pawn]));
+	return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Board.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Win/draw bitbase for king and pawn against king, built into the engine when it starts (no
+// file to ship). One bit per position: 24 pawn squares (files a-d, ranks 2-7) x 64 x 64 king
+// squares x side to move, 24KB in all. Positions with the pawn on files e-h are mirrored first.
+class KpkBitbase {
+public:
+	static const int Positions = 24 * 64 * 64 * 2;
+
+	// Squares with white holding the pawn; true if white wins
+	static bool probe(int whiteKing, int pawn, int blackKing, bool whiteToMove);
+
+	// For a K+P v K board: sets pawnSideWins and returns true. False for any other material.
+	static bool probe(const Board& board, bool& pawnSideWins);
+};
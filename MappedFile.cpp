@@ -0,0 +1,109 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string& path) {
+	open(path);
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const string& path) {
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	opened = true;
+	if (length == 0)
+		return true; // nothing to map
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		close();
+		return false;
+	}
+	mappingHandle = mapping;
+
+	mapped = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (mapped == nullptr) {
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+	if (mapped) UnmapViewOfFile(mapped);
+	if (mappingHandle) CloseHandle(static_cast<HANDLE>(mappingHandle));
+	if (fileHandle) CloseHandle(static_cast<HANDLE>(fileHandle));
+	mapped = nullptr;
+	mappingHandle = fileHandle = nullptr;
+	length = 0;
+	opened = false;
+}
+
+#else
+
+bool MappedFile::open(const string& path) {
+	close();
+
+	fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close();
+		return false;
+	}
+
+	length = static_cast<size_t>(info.st_size);
+	opened = true;
+	if (length == 0)
+		return true; // nothing to map
+
+	void* address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		close();
+		return false;
+	}
+	mapped = static_cast<const char*>(address);
+	return true;
+}
+
+void MappedFile::close() {
+	if (mapped) munmap(const_cast<char*>(mapped), length);
+	if (fd >= 0) ::close(fd);
+	mapped = nullptr;
+	fd = -1;
+	length = 0;
+	opened = false;
+}
+
+#endif
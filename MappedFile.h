@@ -0,0 +1,34 @@
+#pragma once
+
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Read-only memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const string& path);
+	void close();
+
+	bool isOpen() const { return opened; }
+	const char* data() const { return mapped; }
+	size_t size() const { return length; }
+
+private:
+	const char* mapped = nullptr;
+	size_t length = 0;
+	bool opened = false;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fd = -1;
+#endif
+};
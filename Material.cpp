@@ -0,0 +1,164 @@
+#include "Material.h"
+#include "Board.h"
+#include "Evaluation.h"
+#include "KpkBitbase.h"
+#include <unordered_map>
+#include <functional>
+
+using namespace std;
+
+// Slot order per colour (black adds 6): pawn, knight, light bishop, dark bishop, rook, queen
+enum { PawnSlot, KnightSlot, LightBishopSlot, DarkBishopSlot, RookSlot, QueenSlot };
+
+static const int MaxExtraPieces = 4;
+
+int Material::slot(int piece, int square) {
+	int type = Piece::Type(piece);
+	if (type == Piece::None || type == Piece::King)
+		return -1;
+
+	int colorOffset = Piece::IsWhite(piece) ? 0 : 6;
+	switch (type) {
+	case Piece::Pawn:   return colorOffset + PawnSlot;
+	case Piece::Knight: return colorOffset + KnightSlot;
+	case Piece::Bishop: return colorOffset + (((square / 8 + square % 8) % 2 == 1) ? LightBishopSlot : DarkBishopSlot);
+	case Piece::Rook:   return colorOffset + RookSlot;
+	default:            return colorOffset + QueenSlot;
+	}
+}
+
+uint64_t Material::weight(int piece, int square) {
+	int s = slot(piece, square);
+	return (s < 0) ? 0 : uint64_t(1) << (4 * s);
+}
+
+static int distance(int a, int b) {
+	return max(abs(a % 8 - b % 8), abs(a / 8 - b / 8));
+}
+
+// 0 in the centre up to 60 in the corners
+static int edgeBonus(int square) {
+	int file = square % 8, rank = square / 8;
+	return 10 * ((3 - min(file, 7 - file)) + (3 - min(rank, 7 - rank)));
+}
+
+// Non-king material of one side straight from the key
+static int sideMaterial(uint64_t key, int colorOffset) {
+	return Material::count(key, colorOffset + PawnSlot) * Evaluation::PieceValues[Piece::Pawn]
+		+ Material::count(key, colorOffset + KnightSlot) * Evaluation::PieceValues[Piece::Knight]
+		+ (Material::count(key, colorOffset + LightBishopSlot) + Material::count(key, colorOffset + DarkBishopSlot)) * Evaluation::PieceValues[Piece::Bishop]
+		+ Material::count(key, colorOffset + RookSlot) * Evaluation::PieceValues[Piece::Rook]
+		+ Material::count(key, colorOffset + QueenSlot) * Evaluation::PieceValues[Piece::Queen];
+}
+
+static int kingOf(const Board& board, int color) {
+	return board.kingSquares[color == Piece::White ? 0 : 1];
+}
+
+// K+P v K: the bitbase decides, a win gets credit for pushing the pawn
+static int evaluateKPK(const Board& board, int strongColor) {
+	int pawn = -1;
+	for (int square = 0; square < 64 && pawn == -1; ++square) {
+		if (Piece::Type(board.Square[square]) == Piece::Pawn)
+			pawn = square;
+	}
+
+	int flip = (strongColor == Piece::White) ? 0 : 56;
+	if (!KpkBitbase::probe(kingOf(board, strongColor) ^ flip, pawn ^ flip, kingOf(board, Piece::GetOpponentColor(strongColor)) ^ flip, board.colorToMove == strongColor))
+		return 0;
+	return Evaluation::KnownWin + Evaluation::PieceValues[Piece::Pawn] + 10 * ((pawn ^ flip) / 8);
+}
+
+// Mating material against a bare king: drive it to the edge and bring our king close
+static int evaluateKXK(const Board& board, int strongColor) {
+	int strongKing = kingOf(board, strongColor);
+	int weakKing = kingOf(board, Piece::GetOpponentColor(strongColor));
+	int material = sideMaterial(board.materialKey, strongColor == Piece::White ? 0 : 6);
+	return Evaluation::KnownWin + material + edgeBonus(weakKing) + 10 * (7 - distance(strongKing, weakKing));
+}
+
+// Bishop and knight: the bare king has to be driven into a corner of the bishop's colour
+static int evaluateKBNK(const Board& board, int strongColor) {
+	int strongKing = kingOf(board, strongColor);
+	int weakKing = kingOf(board, Piece::GetOpponentColor(strongColor));
+	bool lightBishop = Material::count(board.materialKey, (strongColor == Piece::White ? 0 : 6) + LightBishopSlot) > 0;
+	int corner = min(distance(weakKing, lightBishop ? 7 : 0), distance(weakKing, lightBishop ? 56 : 63));
+	int material = Evaluation::PieceValues[Piece::Bishop] + Evaluation::PieceValues[Piece::Knight];
+	return Evaluation::KnownWin + material + 20 * (7 - corner) + 10 * (7 - distance(strongKing, weakKing));
+}
+
+static Material::Entry classify(const int counts[Material::Slots]) {
+	Material::Entry entry;
+	int pawns = counts[PawnSlot] + counts[6 + PawnSlot];
+	int heavy = counts[RookSlot] + counts[QueenSlot] + counts[6 + RookSlot] + counts[6 + QueenSlot];
+	int knights = counts[KnightSlot] + counts[6 + KnightSlot];
+	int lightBishops = counts[LightBishopSlot] + counts[6 + LightBishopSlot];
+	int darkBishops = counts[DarkBishopSlot] + counts[6 + DarkBishopSlot];
+
+	// Lone minor, or bishops that all stand on one square colour
+	if (pawns == 0 && heavy == 0) {
+		if (knights + lightBishops + darkBishops <= 1 || (knights == 0 && (lightBishops == 0 || darkBishops == 0))) {
+			entry.insufficient = true;
+			return entry;
+		}
+	}
+
+	uint64_t key = 0;
+	for (int s = 0; s < Material::Slots; ++s)
+		key |= uint64_t(counts[s]) << (4 * s);
+	int white = sideMaterial(key, 0), black = sideMaterial(key, 6);
+	entry.strongColor = (white >= black) ? Piece::White : Piece::Black;
+	int strongOffset = (entry.strongColor == Piece::White) ? 0 : 6;
+	int strong = max(white, black), weak = min(white, black);
+	const int* s = counts + strongOffset;
+
+	if (weak == 0) {
+		if (pawns == 1 && strong == Evaluation::PieceValues[Piece::Pawn]) {
+			entry.evaluate = evaluateKPK;
+			return entry;
+		}
+		if (pawns == 0) {
+			if (s[RookSlot] + s[QueenSlot] > 0 || (s[LightBishopSlot] > 0 && s[DarkBishopSlot] > 0))
+				entry.evaluate = evaluateKXK;
+			else if (s[KnightSlot] == 1 && s[LightBishopSlot] + s[DarkBishopSlot] == 1)
+				entry.evaluate = evaluateKBNK;
+			else
+				entry.drawish = true;    // knights only
+			return entry;
+		}
+	}
+
+	// Without pawns, less than a rook ahead is rarely enough
+	if (pawns == 0 && strong - weak <= Evaluation::PieceValues[Piece::Bishop])
+		entry.drawish = true;
+	return entry;
+}
+
+static unordered_map<uint64_t, Material::Entry> buildTable() {
+	unordered_map<uint64_t, Material::Entry> table;
+	int counts[Material::Slots] = {};
+
+	// Every way to spread up to MaxExtraPieces pieces over the slots
+	function<void(int, int)> fill = [&](int slot, int left) {
+		if (slot == Material::Slots) {
+			uint64_t key = 0;
+			for (int s = 0; s < Material::Slots; ++s)
+				key |= uint64_t(counts[s]) << (4 * s);
+			table[key] = classify(counts);
+			return;
+		}
+		for (int n = 0; n <= left; ++n) {
+			counts[slot] = n;
+			fill(slot + 1, left - n);
+		}
+		counts[slot] = 0;
+	};
+	fill(0, MaxExtraPieces);
+	return table;
+}
+
+const Material::Entry* Material::probe(uint64_t key) {
+	static const unordered_map<uint64_t, Entry> table = buildTable();
+	auto it = table.find(key);
+	return (it == table.end()) ? nullptr : &it->second;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Piece.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+class Board;
+
+// Material signatures: Board::materialKey holds a 4-bit count per piece kind (kings left
+// out, bishops split by square colour), updated on captures and promotions. Material::probe
+// maps the key of every ending with up to four pieces besides the kings to what is known
+// about it, so draw detection and endgame dispatch are one hash lookup.
+class Material {
+public:
+	// Score of a specialised ending from the strong side's point of view
+	typedef int (*EndgameFunction)(const Board& board, int strongColor);
+
+	struct Entry {
+		bool insufficient = false;      // no sequence of legal moves can mate
+		bool drawish = false;           // no pawns and not enough extra material to win by force
+		EndgameFunction evaluate = nullptr;
+		int strongColor = Piece::White;
+	};
+
+	static const int Slots = 12;
+
+	// The key's slot for a piece (kings have none: -1) and the amount it adds to the key
+	static int slot(int piece, int square);
+	static uint64_t weight(int piece, int square);
+	static int count(uint64_t key, int slot) { return static_cast<int>((key >> (4 * slot)) & 15); }
+
+	// nullptr for materials without an entry (more than four pieces besides the kings)
+	static const Entry* probe(uint64_t key);
+};
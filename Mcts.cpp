@@ -0,0 +1,490 @@
+#include "Mcts.h"
+#include <thread>
+#include <cmath>
+
+using namespace std;
+
+static const float UctExploration = 1.4f;
+static const float PuctExploration = 1.5f;
+
+// Playouts cut off at MaxPlayoutPlies are scored by the static evaluation past this margin
+static const int AdjudicationMargin = 200;
+
+static int64_t nowMs() {
+	return chrono::duration_cast<chrono::milliseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Mcts::Mcts() {
+	setTreeSize(16);
+}
+
+void Mcts::setTreeSize(int megabytes) {
+	capacity = max<size_t>(1024, static_cast<size_t>(max(1, megabytes)) * 1024 * 1024 / sizeof(Node) / 2);
+	capacity = min<size_t>(capacity, NoNode - 1);
+	halves[0].reset(new Node[capacity]);
+	halves[1].reset(new Node[capacity]);
+	pool = halves[0].get();
+	newGame();
+}
+
+void Mcts::setThreads(int count) {
+	threadCount = max(1, count);
+}
+
+void Mcts::newGame() {
+	used = 0;
+	root = NoNode;
+}
+
+void Mcts::stop() {
+	stopFlag = true;
+}
+
+void Mcts::ponderHit() {
+	// Latched like Search::ponderHit; whichever of this and think() clears pondering
+	// starts the budget
+	ponderHitLatched = true;
+	if (pondering.exchange(false))
+		startBudget();
+}
+
+// The budget think() worked out counts from now, playouts made while pondering excluded
+void Mcts::startBudget() {
+	int64_t ms = budgetMs.load();
+	uint64_t count = budgetPlayouts.load();
+	stopAtMs = ms > 0 ? nowMs() + ms : 0;
+	playoutLimit = count > 0 ? playoutCount.load() + count : 0;
+}
+
+// Contiguous nodes, or NoNode once the pool is spent
+uint32_t Mcts::allocate(size_t count) {
+	size_t first = used.fetch_add(count);
+	if (first + count > capacity)
+		return NoNode;
+	for (size_t i = first; i < first + count; ++i) {
+		Node& n = pool[i];
+		n.visits.store(0, memory_order_relaxed);
+		n.halfPoints.store(0, memory_order_relaxed);
+		n.firstChild = NoNode;
+		n.childCount = 0;
+		n.move = 0;
+		n.prior = 0;
+		n.state.store(Leaf, memory_order_relaxed);
+		n.terminalHalfPoints = 0;
+	}
+	return static_cast<uint32_t>(first);
+}
+
+void Mcts::resetTree(const Board& board) {
+	used = 0;
+	root = allocate(1);
+	rootBoard = board;
+}
+
+// The new position is usually the old root plus our move and the reply: look for it one or
+// two plies down and keep the subtree below it.
+bool Mcts::reuseTree(const Board& board) {
+	if (root == NoNode)
+		return false;
+
+	uint32_t found = NoNode;
+	if (rootBoard.zobristKey == board.zobristKey)
+		found = root;
+	const Node& top = pool[root];
+	for (uint32_t c = top.firstChild; found == NoNode && top.state.load() == Expanded && c < top.firstChild + top.childCount; ++c) {
+		Board child = rootBoard;
+		Move m = unpackMove(child, pool[c].move);
+		child.makeMove(m, child);
+		if (child.zobristKey == board.zobristKey) {
+			found = c;
+			break;
+		}
+
+		const Node& node = pool[c];
+		for (uint32_t g = node.firstChild; node.state.load() == Expanded && g < node.firstChild + node.childCount; ++g) {
+			Board grandchild = child;
+			Move reply = unpackMove(grandchild, pool[g].move);
+			grandchild.makeMove(reply, grandchild);
+			if (grandchild.zobristKey == board.zobristKey) {
+				found = g;
+				break;
+			}
+		}
+	}
+
+	// A node scored as a draw by repetition cannot be searched from
+	if (found == NoNode || pool[found].state.load() == Terminal)
+		return false;
+	keepSubtree(found);
+	rootBoard = board;
+	return true;
+}
+
+// Copies the subtree breadth first into the other half, so children stay contiguous
+void Mcts::keepSubtree(uint32_t node) {
+	Node* from = pool;
+	pool = (pool == halves[0].get()) ? halves[1].get() : halves[0].get();
+	used = 0;
+	root = allocate(1);
+
+	vector<pair<uint32_t, uint32_t>> queue = { { node, root } };
+	for (size_t i = 0; i < queue.size(); ++i) {
+		const Node& source = from[queue[i].first];
+		Node& target = pool[queue[i].second];
+		target.visits.store(source.visits.load());
+		target.halfPoints.store(source.halfPoints.load());
+		target.move = source.move;
+		target.prior = source.prior;
+		target.terminalHalfPoints = source.terminalHalfPoints;
+		target.state.store(source.state.load());
+		if (source.state.load() != Expanded)
+			continue;
+
+		target.firstChild = allocate(source.childCount);
+		target.childCount = source.childCount;
+		for (uint32_t c = 0; c < source.childCount; ++c)
+			queue.push_back({ source.firstChild + c, target.firstChild + c });
+	}
+}
+
+// Moves are stored as from/to/promotion: the rest follows from the board they are played on
+Move Mcts::unpackMove(const Board& board, uint16_t packed) {
+	return board.moveFromSquares(packed & 63, (packed >> 6) & 63, packed >> 12);
+}
+
+// Light policy, also the PUCT prior: captures by the value taken, promotions by the new piece
+float Mcts::moveWeight(const Board& board, const Move& move) {
+	float weight = 1.0f;
+	int captured = Piece::Type(board.Square[move.targetSquare]);
+	if (move.type == Move::EnPassant)
+		captured = Piece::Pawn;
+	if (captured != Piece::None)
+		weight += Evaluation::PieceValues[captured] / 100.0f;
+	if (move.type == Move::Promotion)
+		weight += Evaluation::PieceValues[move.promotionPiece] / 100.0f;
+	return weight;
+}
+
+// Creates the children, or marks the node Terminal. False if it was left a Leaf (pool full).
+bool Mcts::expand(Node& node, Board& board, moveGenerator& generator, const vector<uint64_t>& path) {
+	uint8_t result = 0xff;
+	vector<Move> moves;
+	// Draw rules only below the root: the root is always searched
+	bool repeated = history.count(board.zobristKey) > 0
+		|| find(path.begin(), path.end() - 1, board.zobristKey) != path.end() - 1;
+	bool drawn = repeated || board.halfmoveClock >= 100 || (board.pieceTotal <= 4 && board.hasInsufficientMaterial());
+	if (path.size() > 1 && drawn)
+		result = 1;
+	else {
+		moves = generator.GenerateLegalMoves(&board);
+		if (moves.empty()) {
+			int kingSq = board.findKingSquare(board.colorToMove);
+			result = board.isSquareAttacked(kingSq, Piece::GetOpponentColor(board.colorToMove), board) ? 2 : 1;
+		}
+	}
+
+	if (result != 0xff) {
+		node.terminalHalfPoints = result;
+		node.state.store(Terminal, memory_order_release);
+		return true;
+	}
+
+	uint32_t first = allocate(moves.size());
+	if (first == NoNode) {
+		node.state.store(Leaf, memory_order_release);
+		return false;
+	}
+
+	float total = 0;
+	for (size_t i = 0; i < moves.size(); ++i) {
+		Node& child = pool[first + i];
+		child.move = TranspositionTable::packMove(moves[i]);
+		child.prior = selection == Puct ? moveWeight(board, moves[i]) : 1.0f;
+		total += child.prior;
+	}
+	for (size_t i = 0; i < moves.size(); ++i)
+		pool[first + i].prior /= total;
+
+	node.firstChild = first;
+	node.childCount = static_cast<uint16_t>(moves.size());
+	node.state.store(Expanded, memory_order_release);
+	return true;
+}
+
+uint32_t Mcts::select(const Node& node) const {
+	uint32_t parentVisits = max<uint32_t>(1, node.visits.load(memory_order_relaxed));
+	float logParent = log(static_cast<float>(parentVisits));
+	float sqrtParent = sqrt(static_cast<float>(parentVisits));
+	// PUCT first-play urgency: an unvisited child is assumed as good as its parent's position
+	uint32_t parentPoints = node.halfPoints.load(memory_order_relaxed);
+	float fpu = 1.0f - parentPoints / (2.0f * parentVisits);
+
+	uint32_t best = NoNode;
+	float bestScore = -1e30f;
+	for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; ++c) {
+		const Node& child = pool[c];
+		if (child.state.load(memory_order_acquire) == Terminal && child.terminalHalfPoints == 2)
+			return c; // mate in one
+
+		uint32_t visits = child.visits.load(memory_order_relaxed);
+		float q = visits ? child.halfPoints.load(memory_order_relaxed) / (2.0f * visits) : fpu;
+		float score;
+		if (selection == Puct)
+			score = q + PuctExploration * child.prior * sqrtParent / (1 + visits);
+		else if (visits == 0)
+			return c;
+		else
+			score = q + UctExploration * sqrt(logParent / visits);
+
+		if (score > bestScore) {
+			bestScore = score;
+			best = c;
+		}
+	}
+	return best;
+}
+
+// Half points for white: 2 win, 1 draw, 0 loss. Moves are drawn from the pseudo-legal list
+// and only the drawn ones are tested for legality.
+int Mcts::playoutFrom(Board& board, moveGenerator& generator, mt19937& rng) const {
+	vector<Move> moves;
+	vector<float> weights;
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (int ply = 0; ply < MaxPlayoutPlies; ++ply) {
+		if (board.halfmoveClock >= 100 || (board.pieceTotal <= 4 && board.hasInsufficientMaterial()))
+			return 1;
+
+		Move move(0, 0);
+		bool found = false;
+		if (playout == LightPlayout) {
+			moves = generator.GenerateMoves(&board);
+			weights.resize(moves.size());
+			float total = 0;
+			for (size_t i = 0; i < moves.size(); ++i)
+				total += weights[i] = moveWeight(board, moves[i]);
+
+			// Weighted draw without replacement: illegal moves are swapped out of the range
+			for (size_t left = moves.size(); left > 0 && !found; --left) {
+				float r = unit(rng) * total;
+				size_t pick = 0;
+				for (; pick + 1 < left && r >= weights[pick]; ++pick)
+					r -= weights[pick];
+				if (generator.IsLegalMove(&board, moves[pick])) {
+					move = moves[pick];
+					found = true;
+				}
+				else {
+					total -= weights[pick];
+					swap(moves[pick], moves[left - 1]);
+					swap(weights[pick], weights[left - 1]);
+				}
+			}
+		}
+		else {
+			found = generator.GenerateRandomLegalMove(&board, rng, move);
+		}
+
+		if (!found) {
+			int kingSq = board.findKingSquare(board.colorToMove);
+			if (!board.isSquareAttacked(kingSq, Piece::GetOpponentColor(board.colorToMove), board))
+				return 1;
+			return board.colorToMove == Piece::White ? 0 : 2;
+		}
+		board.makeMove(move, board);
+	}
+
+	int eval = Evaluation::evaluate(board);
+	if (board.colorToMove == Piece::Black)
+		eval = -eval;
+	return eval > AdjudicationMargin ? 2 : eval < -AdjudicationMargin ? 0 : 1;
+}
+
+void Mcts::runWorker(uint32_t seed) {
+	mt19937 rng(seed);
+	moveGenerator generator;
+	vector<uint32_t> path;
+	vector<uint64_t> keys;
+
+	while (!stopFlag.load(memory_order_relaxed)) {
+		Board board = rootBoard;
+		path.assign(1, root);
+		keys.assign(1, board.zobristKey);
+		int result = -1;        // half points for white
+
+		uint32_t current = root;
+		while (true) {
+			Node& node = pool[current];
+			node.visits.fetch_add(1, memory_order_relaxed);
+
+			uint8_t state = node.state.load(memory_order_acquire);
+			bool expandedNow = false;
+			if (state == Leaf && path.size() <= MaxTreeDepth && used.load(memory_order_relaxed) < capacity) {
+				uint8_t expected = Leaf;
+				if (node.state.compare_exchange_strong(expected, Expanding))
+					expandedNow = expand(node, board, generator, keys);
+				state = node.state.load(memory_order_acquire);
+			}
+
+			if (state == Terminal) {
+				// Scored for the side that moved into the node
+				int mover = board.colorToMove == Piece::White ? Piece::Black : Piece::White;
+				result = mover == Piece::White ? node.terminalHalfPoints : 2 - node.terminalHalfPoints;
+				break;
+			}
+			// Just expanded, still a leaf, or being expanded by another thread: play out from here
+			if (state != Expanded || expandedNow)
+				break;
+
+			uint32_t child = select(node);
+			Move m = unpackMove(board, pool[child].move);
+			board.makeMove(m, board);
+			current = child;
+			path.push_back(current);
+			keys.push_back(board.zobristKey);
+		}
+
+		if (result < 0)
+			result = playoutFrom(board, generator, rng);
+
+		// The root's mover is the side that did not move; it alternates from there
+		int mover = rootBoard.colorToMove == Piece::White ? Piece::Black : Piece::White;
+		for (uint32_t n : path) {
+			pool[n].halfPoints.fetch_add(mover == Piece::White ? result : 2 - result, memory_order_relaxed);
+			mover = Piece::GetOpponentColor(mover);
+		}
+
+		int depth = static_cast<int>(path.size()) - 1;
+		int deepest = maxDepth.load(memory_order_relaxed);
+		while (depth > deepest && !maxDepth.compare_exchange_weak(deepest, depth)) {
+		}
+
+		uint64_t done = ++playoutCount;
+		uint64_t limit = playoutLimit.load(memory_order_relaxed);
+		int64_t stopAt = stopAtMs.load(memory_order_relaxed);
+		if ((limit > 0 && done >= limit) || (stopAt > 0 && (done & 15) == 0 && nowMs() >= stopAt))
+			stopFlag = true;
+	}
+}
+
+SearchInfo Mcts::info(int64_t elapsedMs) const {
+	SearchInfo result;
+	result.depth = maxDepth.load();
+	result.nodes = playouts();
+	result.timeMs = elapsedMs;
+
+	// Principal variation: the most visited child at every step
+	uint32_t node = root;
+	Board board = rootBoard;
+	while (node != NoNode && pool[node].state.load() == Expanded && result.pv.size() < 16) {
+		uint32_t best = NoNode;
+		for (uint32_t c = pool[node].firstChild; c < pool[node].firstChild + pool[node].childCount; ++c) {
+			if (best == NoNode || pool[c].visits.load() > pool[best].visits.load()
+				|| (pool[c].state.load() == Terminal && pool[c].terminalHalfPoints == 2))
+				best = c;
+			if (pool[c].state.load() == Terminal && pool[c].terminalHalfPoints == 2)
+				break;
+		}
+		if (best == NoNode || (pool[best].visits.load() == 0 && result.pv.size() > 0))
+			break;
+
+		Move m = unpackMove(board, pool[best].move);
+		board.makeMove(m, board);
+		result.pv.push_back(m);
+
+		if (result.pv.size() == 1) {
+			const Node& n = pool[best];
+			uint32_t visits = n.visits.load();
+			if (n.state.load() == Terminal && n.terminalHalfPoints == 2)
+				result.score = Search::MateScore - 1;
+			else if (visits > 0) {
+				double q = min(max(n.halfPoints.load() / (2.0 * visits), 0.001), 0.999);
+				result.score = static_cast<int>(-400.0 * log10(1.0 / q - 1.0));
+			}
+		}
+		node = best;
+	}
+	return result;
+}
+
+Move Mcts::think(const Board& board, const SearchLimits& limits, function<void(const SearchInfo&)> onInfo) {
+	stopFlag = false;
+	playoutCount = 0;
+	maxDepth = 0;
+	int64_t started = nowMs();
+
+	// Same budget rule as Search
+	int64_t allocatedMs = 0;
+	int timeLeft = board.colorToMove == Piece::White ? limits.wtime : limits.btime;
+	int increment = board.colorToMove == Piece::White ? limits.winc : limits.binc;
+	if (limits.movetime > 0)
+		allocatedMs = limits.movetime;
+	else if (timeLeft >= 0) {
+		int movesToGo = (limits.movestogo > 0) ? min(limits.movestogo, 40) : 30;
+		allocatedMs = max<int64_t>(1, min<int64_t>(timeLeft / movesToGo + increment * 3 / 4, timeLeft - 50));
+	}
+	budgetMs = limits.infinite ? 0 : allocatedMs;
+	budgetPlayouts = limits.infinite ? 0 : (limits.nodes > 0 ? limits.nodes : (allocatedMs > 0 ? 0 : 10000));
+	stopAtMs = 0;
+	playoutLimit = 0;
+	// A ponder search only starts its budget on ponderhit, which may already have arrived
+	pondering = limits.ponder;
+	if (!limits.ponder || (ponderHitLatched && pondering.exchange(false)))
+		startBudget();
+
+	history.clear();
+	for (const auto& entry : board.repetitionMap) {
+		if (entry.second > 0 && entry.first != board.zobristKey)
+			history.insert(entry.first);
+	}
+	if (!reuseTree(board))
+		resetTree(board);
+	// Workers copy rootBoard on every playout: leave the game record out of it
+	rootBoard.repetitionMap.clear();
+
+	moveGenerator generator;
+	Board copy = board;
+	vector<Move> legal = generator.GenerateLegalMoves(&copy);
+	if (legal.empty()) {
+		ponderHitLatched = false;
+		pondering = false;
+		return Move(0, 0);
+	}
+
+	random_device seeds;
+	vector<uint32_t> threadSeeds(threadCount);
+	for (auto& seed : threadSeeds)
+		seed = seeds();
+
+	vector<thread> helpers;
+	for (int i = 1; i < threadCount; ++i)
+		helpers.emplace_back([this, &threadSeeds, i]() { runWorker(threadSeeds[i]); });
+
+	// A separate thread reports once a second while the main thread searches too
+	thread reporter;
+	if (onInfo) {
+		reporter = thread([this, &onInfo, started]() {
+			int64_t next = started + 1000;
+			while (!stopFlag.load()) {
+				this_thread::sleep_for(chrono::milliseconds(10));
+				if (nowMs() >= next && !stopFlag.load()) {
+					onInfo(info(nowMs() - started));
+					next += 1000;
+				}
+			}
+		});
+	}
+	runWorker(threadSeeds[0]);
+
+	for (auto& t : helpers)
+		t.join();
+	if (reporter.joinable())
+		reporter.join();
+
+	ponderHitLatched = false;
+	pondering = false;
+	SearchInfo last = info(nowMs() - started);
+	if (onInfo)
+		onInfo(last);
+	return last.pv.empty() ? legal[0] : last.pv[0];
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Search.h"
+#include "useFullStuff.h"
+#include <atomic>
+#include <memory>
+#include <unordered_set>
+
+using namespace std;
+
+// Monte Carlo tree search, a second engine type beside Search (mostly for self-play variety).
+// Every iteration walks down the tree by UCT or PUCT, expands the leaf it reaches and scores
+// it with one playout: uniformly random moves like Agent::playRandomMove, or light ones that
+// prefer captures and promotions. Threads share one tree. A visit is counted on the way down
+// and its result only added on the way up, so a line being played out looks lost to the other
+// threads for a moment (virtual loss) and they spread over different lines.
+//
+// Nodes come from a fixed pool: the children of a node are a contiguous run taken with a
+// single atomic bump and nothing is freed one by one. The pool has two halves; when a new
+// think() starts from a position already in the tree (our move and the reply were searched),
+// that subtree is copied into the other half and becomes the new tree, dropping the rest.
+// SearchInfo::nodes counts playouts.
+class Mcts {
+public:
+	enum Selection { Uct, Puct };
+	enum Playout { RandomPlayout, LightPlayout };
+
+	Mcts();
+
+	void setTreeSize(int megabytes);
+	void setThreads(int count);
+	void setSelection(Selection s) { selection = s; }
+	void setPlayout(Playout p) { playout = p; }
+	void newGame();
+
+	// SearchLimits::nodes counts playouts; depth is ignored. Scores are centipawns from the
+	// win rate of the chosen move, or a mate score when that move mates at once.
+	// Ponder searches run until stop() or ponderHit(), which starts the budget of the limits.
+	Move think(const Board& board, const SearchLimits& limits, function<void(const SearchInfo&)> onInfo = nullptr);
+	void stop();
+	void ponderHit();
+
+	uint64_t playouts() const { return playoutCount.load(memory_order_relaxed); }
+
+private:
+	static const uint32_t NoNode = 0xffffffff;
+	static const int MaxTreeDepth = 128;
+	static const int MaxPlayoutPlies = 200;
+
+	enum State : uint8_t { Leaf, Expanding, Expanded, Terminal };
+
+	struct Node {
+		atomic<uint32_t> visits{ 0 };
+		atomic<uint32_t> halfPoints{ 0 };   // for the side that played move: 2 a win, 1 a draw
+		uint32_t firstChild = NoNode;
+		uint16_t childCount = 0;
+		uint16_t move = 0;                  // TranspositionTable::packMove
+		float prior = 0;
+		atomic<uint8_t> state{ Leaf };
+		uint8_t terminalHalfPoints = 0;     // set with Terminal
+	};
+
+	unique_ptr<Node[]> halves[2];
+	Node* pool = nullptr;                   // the half in use
+	size_t capacity = 0;                    // nodes per half
+	atomic<size_t> used{ 0 };
+	uint32_t root = NoNode;
+	Board rootBoard;
+	unordered_set<uint64_t> history;        // positions of the game so far, for repetitions
+
+	Selection selection = Uct;
+	Playout playout = RandomPlayout;
+	int threadCount = 1;
+	atomic<bool> stopFlag{ false };
+	atomic<uint64_t> playoutCount{ 0 };
+	atomic<int> maxDepth{ 0 };
+	atomic<int64_t> budgetMs{ 0 };          // from the limits, 0: none
+	atomic<uint64_t> budgetPlayouts{ 0 };   // from the limits, 0: none
+	atomic<bool> pondering{ false };
+	atomic<bool> ponderHitLatched{ false };
+	atomic<int64_t> stopAtMs{ 0 };          // 0: no deadline
+	atomic<uint64_t> playoutLimit{ 0 };     // counted in playoutCount, 0: no limit
+
+	uint32_t allocate(size_t count);
+	void resetTree(const Board& board);
+	bool reuseTree(const Board& board);
+	void keepSubtree(uint32_t node);
+
+	static Move unpackMove(const Board& board, uint16_t packed);
+	static float moveWeight(const Board& board, const Move& move);
+
+	void startBudget();
+	void runWorker(uint32_t seed);
+	bool expand(Node& node, Board& board, moveGenerator& generator, const vector<uint64_t>& path);
+	uint32_t select(const Node& node) const;
+	int playoutFrom(Board& board, moveGenerator& generator, mt19937& rng) const;
+
+	SearchInfo info(int64_t elapsedMs) const;
+};
@@ -0,0 +1,101 @@
+#include "PackedBoard.h"
+#include <cstring>
+
+using namespace std;
+
+// Nibble for each piece code (0 for an empty square, which is never stored)
+static const uint8_t NibbleOfPiece[16] = {
+	0, 0, 1, 2, 3, 4, 5, 0,
+	0, 8, 9, 10, 11, 12, 13, 0
+};
+
+// Piece code for each nibble; the unmoved rook codes give plain rooks
+static const uint8_t PieceOfNibble[16] = {
+	Piece::WhitePawn, Piece::WhiteKnight, Piece::WhiteBishop, Piece::WhiteRook, Piece::WhiteQueen, Piece::WhiteKing, Piece::WhiteRook, Piece::None,
+	Piece::BlackPawn, Piece::BlackKnight, Piece::BlackBishop, Piece::BlackRook, Piece::BlackQueen, Piece::BlackKing, Piece::BlackRook, Piece::None
+};
+
+// Added to a rook's nibble to mark it unmoved
+static const int UnmovedRookOffset = (PackedBoard::UnmovedRook - 1) - (Piece::Rook - 1);
+
+PackedBoard PackedBoard::pack(const Board& board) {
+	PackedBoard packed = {};
+
+	// Rooks that can still castle; a right without its rook in the corner is dropped
+	uint64_t unmovedRooks = 0;
+	const int corners[4] = { 7, 0, 63, 56 };
+	const bool rights[4] = { board.castlingRights.whiteKingside, board.castlingRights.whiteQueenside,
+		board.castlingRights.blackKingside, board.castlingRights.blackQueenside };
+	for (int i = 0; i < 4; ++i)
+		unmovedRooks |= uint64_t(rights[i] && Piece::Type(board.Square[corners[i]]) == Piece::Rook) << corners[i];
+
+	// Nibbles collect in two words; an empty square writes a 0 that the next piece overwrites
+	uint64_t nibbles[2] = { 0, 0 };
+	int n = 0;
+	for (int square = 0; square < 64; ++square) {
+		int piece = board.Square[square];
+		uint64_t present = (piece != Piece::None);
+		uint64_t nibble = NibbleOfPiece[piece] + UnmovedRookOffset * ((unmovedRooks >> square) & 1);
+		packed.occupancy |= present << square;
+		nibbles[(n >> 4) & 1] |= nibble << (4 * (n & 15));
+		n += static_cast<int>(present);
+	}
+	memcpy(packed.pieces, nibbles, sizeof(packed.pieces));
+
+	packed.sideAndEnPassant = static_cast<uint8_t>((board.colorToMove == Piece::Black ? 0x80 : 0) | (board.enPassantSquare == -1 ? 64 : board.enPassantSquare));
+	packed.halfmoveClock = static_cast<uint8_t>(min(board.halfmoveClock, 255));
+	packed.fullmoveNumber = static_cast<uint16_t>(min<int>(board.fullmoveNumber, 65535));
+	return packed;
+}
+
+bool PackedBoard::unpack(Board& board) const {
+	uint64_t nibbles[2];
+	memcpy(nibbles, pieces, sizeof(nibbles));
+
+	uint64_t unmovedRooks = 0;
+	int n = 0;
+	for (int square = 0; square < 64; ++square) {
+		uint64_t present = (occupancy >> square) & 1;
+		int nibble = static_cast<int>((nibbles[(n >> 4) & 1] >> (4 * (n & 15))) & 15);
+		board.Square[square] = present ? PieceOfNibble[nibble] : Piece::None;
+		unmovedRooks |= (present & ((nibble & 7) == UnmovedRook - 1)) << square;
+		n += static_cast<int>(present);
+	}
+
+	board.colorToMove = (sideAndEnPassant & 0x80) ? Piece::Black : Piece::White;
+	int enPassant = sideAndEnPassant & 0x7f;
+	board.enPassantSquare = (enPassant < 64) ? enPassant : -1;
+	board.halfmoveClock = halfmoveClock;
+	board.fullmoveNumber = max<int>(1, fullmoveNumber);
+
+	board.castlingRights.whiteKingside = (unmovedRooks >> 7) & 1;
+	board.castlingRights.whiteQueenside = unmovedRooks & 1;
+	board.castlingRights.blackKingside = (unmovedRooks >> 63) & 1;
+	board.castlingRights.blackQueenside = (unmovedRooks >> 56) & 1;
+
+	// Same derived flags as setFen
+	board.whiteKingsideRookMoved = !board.castlingRights.whiteKingside;
+	board.whiteQueensideRookMoved = !board.castlingRights.whiteQueenside;
+	board.blackKingsideRookMoved = !board.castlingRights.blackKingside;
+	board.blackQueensideRookMoved = !board.castlingRights.blackQueenside;
+	board.whiteKingMoved = board.whiteKingsideRookMoved && board.whiteQueensideRookMoved;
+	board.blackKingMoved = board.blackKingsideRookMoved && board.blackQueensideRookMoved;
+
+	board.kingSquares[0] = board.findKingSquare(Piece::White);
+	board.kingSquares[1] = board.findKingSquare(Piece::Black);
+	board.zobristKey = board.computeZobristHash(board);
+	board.computeMaterial();
+	board.repetitionMap.clear();
+
+	return board.kingSquares[0] != -1 && board.kingSquares[1] != -1;
+}
+
+bool PackedBoard::roundTrips(const Board& board) {
+	PackedBoard packed = pack(board);
+	Board unpacked;
+	if (!packed.unpack(unpacked))
+		return false;
+	PackedBoard repacked = pack(unpacked);
+	return unpacked.getFen() == board.getFen() && unpacked.zobristKey == board.zobristKey
+		&& unpacked.materialKey == board.materialKey && memcmp(&packed, &repacked, sizeof(PackedBoard)) == 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Board.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Fixed 32-byte position, a plain struct that can be copied straight to and from files
+// or shared memory (little endian). Pieces are one nibble per occupied square in square
+// order, a1 first: colour << 3 | (type - 1), where type 7 is a rook that can still castle,
+// so castling rights need no field of their own. score and result are optional labels
+// (training data); pack() leaves them 0.
+struct PackedBoard {
+	uint64_t occupancy;         // bit per square, a1 = bit 0
+	uint8_t pieces[16];
+	uint8_t sideAndEnPassant;   // bit 7 black to move, low 7 bits en passant square (64 = none)
+	uint8_t halfmoveClock;
+	uint16_t fullmoveNumber;
+	int16_t score;              // centipawns, white's point of view
+	uint8_t result;             // Result
+	uint8_t reserved;
+
+	enum Result : uint8_t { BlackWin = 0, Draw = 1, WhiteWin = 2 };
+
+	static const int UnmovedRook = 7;
+
+	static PackedBoard pack(const Board& board);
+
+	// Sets up board like setFen (moved flags, king squares, Zobrist key, material); false if
+	// a king is missing
+	bool unpack(Board& board) const;
+
+	// Packs, unpacks and repacks board and compares FEN, Zobrist key, material key and bytes;
+	// run by selftest
+	static bool roundTrips(const Board& board);
+};
+
+static_assert(sizeof(PackedBoard) == 32, "PackedBoard is part of the file format");
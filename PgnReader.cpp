@@ -0,0 +1,206 @@
+#include "PgnReader.h"
+#include "notation.h"
+#include <thread>
+#include <atomic>
+#include <cstring>
+
+using namespace std;
+
+string_view PgnGame::tag(string_view name) const {
+	for (const auto& t : tags) {
+		if (t.first == name)
+			return t.second;
+	}
+	return string_view();
+}
+
+PgnReader::PgnReader(const string& path) : file(path) {
+}
+
+bool PgnReader::isOpen() const {
+	return file.isOpen();
+}
+
+size_t PgnReader::fileSize() const {
+	return file.size();
+}
+
+// First "[Event " at the start of a line in [from, limit), or limit
+size_t PgnReader::findGameStart(size_t from, size_t limit) const {
+	const char* data = file.data();
+	size_t pos = from;
+
+	// Only line starts count: move to the start of the next line unless already on one
+	if (pos > 0 && data[pos - 1] != '\n') {
+		const char* nl = static_cast<const char*>(memchr(data + pos, '\n', limit - pos));
+		if (!nl)
+			return limit;
+		pos = static_cast<size_t>(nl - data) + 1;
+	}
+
+	while (pos < limit) {
+		if (limit - pos >= 7 && memcmp(data + pos, "[Event ", 7) == 0)
+			return pos;
+		const char* nl = static_cast<const char*>(memchr(data + pos, '\n', limit - pos));
+		if (!nl)
+			return limit;
+		pos = static_cast<size_t>(nl - data) + 1;
+	}
+	return limit;
+}
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void PgnReader::parseGame(string_view text, Board& board, moveGenerator& generator, PgnGame& game) {
+	game.text = text;
+	game.tags.clear();
+	game.moves.clear();
+	game.fen = string_view();
+	game.result = string_view();
+	game.valid = true;
+	game.errorPly = 0;
+
+	const char* p = text.data();
+	const char* end = p + text.size();
+
+	// Tag pairs: [Name "Value"]
+	while (true) {
+		while (p < end && isSpace(*p)) ++p;
+		if (p >= end || *p != '[')
+			break;
+
+		const char* nameStart = ++p;
+		while (p < end && !isSpace(*p) && *p != '"' && *p != ']') ++p;
+		string_view name(nameStart, p - nameStart);
+
+		while (p < end && *p != '"' && *p != ']' && *p != '\n') ++p;
+		string_view value;
+		if (p < end && *p == '"') {
+			const char* valueStart = ++p;
+			while (p < end && *p != '"' && *p != '\n') {
+				if (*p == '\\' && p + 1 < end) ++p; // escaped quote or backslash
+				++p;
+			}
+			value = string_view(valueStart, p - valueStart);
+		}
+
+		const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+		p = nl ? nl + 1 : end;
+
+		game.tags.push_back({ name, value });
+		if (name == "FEN")
+			game.fen = value;
+		else if (name == "Result")
+			game.result = value;
+	}
+
+	if (!game.fen.empty())
+		game.valid = board.setFen(game.fen.data(), game.fen.size());
+	else
+		board.setFen(Board::StartFen);
+
+	// Movetext
+	int variationDepth = 0;
+	while (p < end && game.valid) {
+		char c = *p;
+
+		if (isSpace(c)) { ++p; continue; }
+		if (c == '{') { // comment
+			const char* close = static_cast<const char*>(memchr(p, '}', end - p));
+			p = close ? close + 1 : end;
+			continue;
+		}
+		if (c == ';') { // comment to end of line
+			const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+			p = nl ? nl + 1 : end;
+			continue;
+		}
+		if (c == '(') { variationDepth++; ++p; continue; }
+		if (c == ')') { variationDepth = max(0, variationDepth - 1); ++p; continue; }
+
+		const char* tokenStart = p;
+		while (p < end && !isSpace(*p) && *p != '{' && *p != '(' && *p != ')' && *p != ';') ++p;
+		string_view token(tokenStart, p - tokenStart);
+
+		if (variationDepth > 0 || token[0] == '$')
+			continue; // side lines and NAGs
+
+		if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+			if (game.result.empty())
+				game.result = token;
+			break;
+		}
+
+		// Move number ("12." or "12...") possibly glued to the move ("12.e4")
+		size_t skip = 0;
+		while (skip < token.size() && token[skip] >= '0' && token[skip] <= '9') ++skip;
+		if (skip > 0 && skip < token.size() && token[skip] == '.') {
+			while (skip < token.size() && token[skip] == '.') ++skip;
+			token.remove_prefix(skip);
+		}
+		if (token.empty())
+			continue;
+
+		vector<Move> legal = generator.GenerateLegalMoves(&board);
+		Move move(0, 0);
+		if (!notation::sanToMove(token.data(), token.size(), board, legal, move)) {
+			game.valid = false;
+			game.errorPly = game.moves.size();
+			break;
+		}
+
+		board.makeMove(move, board);
+		game.moves.push_back(move);
+	}
+
+	if (game.result.empty())
+		game.result = "*";
+}
+
+size_t PgnReader::read(int threads, const GameCallback& onGame) {
+	size_t size = file.size();
+	if (size == 0)
+		return 0;
+	threads = max(1, threads);
+
+	// A few chunks per thread keeps the load even when games differ in length
+	size_t chunkCount = max<size_t>(1, min<size_t>(threads * 8, size / (64 * 1024) + 1));
+	vector<size_t> boundaries;
+	boundaries.push_back(findGameStart(0, size));
+	for (size_t i = 1; i < chunkCount; ++i)
+		boundaries.push_back(max(boundaries.back(), findGameStart(size * i / chunkCount, size)));
+	boundaries.push_back(size);
+
+	atomic<size_t> nextChunk{ 0 };
+	atomic<size_t> gameCount{ 0 };
+
+	auto worker = [&](int threadIndex) {
+		Board board;
+		moveGenerator generator;
+		PgnGame game;
+
+		for (size_t chunk = nextChunk++; chunk + 1 < boundaries.size(); chunk = nextChunk++) {
+			size_t pos = boundaries[chunk];
+			size_t chunkEnd = boundaries[chunk + 1];
+
+			while (pos < chunkEnd) {
+				size_t next = findGameStart(pos + 1, chunkEnd);
+				parseGame(string_view(file.data() + pos, next - pos), board, generator, game);
+				onGame(game, threadIndex);
+				gameCount++;
+				pos = next;
+			}
+		}
+	};
+
+	vector<thread> pool;
+	for (int i = 1; i < threads; ++i)
+		pool.emplace_back(worker, i);
+	worker(0);
+	for (auto& t : pool)
+		t.join();
+
+	return gameCount;
+}
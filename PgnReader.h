@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Board.h"
+#include "moveGenerator.h"
+#include "MappedFile.h"
+#include "useFullStuff.h"
+#include <functional>
+#include <string_view>
+
+using namespace std;
+
+// One parsed game. Text fields are views into the mapped file and the vectors are reused
+// from game to game, so nothing is allocated per game once a worker has warmed up.
+struct PgnGame {
+	string_view text;                                  // the whole game as it appears in the file
+	vector<pair<string_view, string_view>> tags;       // name, value (escapes left as written)
+	string_view fen;                                   // FEN tag, empty for the standard start
+	string_view result;                                // "1-0", "0-1", "1/2-1/2" or "*"
+	vector<Move> moves;                                // validated against Board/moveGenerator
+	bool valid = true;                                 // false if a move did not parse or was illegal
+	size_t errorPly = 0;
+
+	string_view tag(string_view name) const;
+};
+
+// Splits a memory-mapped PGN file at "[Event " lines and parses the pieces on several threads.
+// Games inside a chunk are delivered in file order; chunks are not, so the callback must be
+// thread safe. threadIndex (0..threads-1) lets callers keep per-thread state.
+class PgnReader {
+public:
+	using GameCallback = function<void(const PgnGame& game, int threadIndex)>;
+
+	explicit PgnReader(const string& path);
+
+	bool isOpen() const;
+	size_t fileSize() const;
+
+	// Returns the number of games delivered
+	size_t read(int threads, const GameCallback& onGame);
+
+	// Parses one game's text (tags and movetext) starting from a fresh board
+	static void parseGame(string_view text, Board& board, moveGenerator& generator, PgnGame& game);
+
+private:
+	MappedFile file;
+
+	size_t findGameStart(size_t from, size_t limit) const;
+};
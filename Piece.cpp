@@ -85,6 +85,9 @@ int Piece::Type(int piece) {
 void Piece::fenToBoard(const string& fen1, int Square[64]) {
 	string fen = fen1;
 
+	for (int i = 0; i < 64; ++i)
+		Square[i] = Piece::None;
+
 	int rank = 7; // Start from rank 8 (top)
 	int file = 0;
 
@@ -120,9 +123,4 @@ void Piece::fenToBoard(const string& fen1, int Square[64]) {
 		}
 	}
 
-	// Optional: fill rest of board with Piece::None
-	for (int i = 0; i < 64; ++i) {
-		if (Square[i] == 0)
-			Square[i] = Piece::None;
-	}
 }
\ No newline at end of file
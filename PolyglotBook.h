@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Board.h"
+#include "MappedFile.h"
+#include "useFullStuff.h"
+#include <random>
+
+using namespace std;
+
+// Opening book in the Polyglot .bin format: 16-byte big-endian entries (key, move, weight,
+// learn) sorted by key. The file is memory-mapped and probed with a binary search, so
+// opening a book costs nothing and lookups never allocate beyond the returned entries.
+class PolyglotBook {
+public:
+	struct Entry {
+		uint64_t key;
+		uint16_t move;          // to file | to row << 3 | from file << 6 | from row << 9 | promotion << 12
+		uint16_t weight;
+		uint32_t learn;
+	};
+
+	static const size_t EntrySize = 16;
+
+	PolyglotBook() = default;
+	explicit PolyglotBook(const string& path);
+
+	bool open(const string& path);
+	bool isOpen() const;
+	size_t entryCount() const;
+
+	// Polyglot hash of a position (not the same numbers as Board::zobristKey)
+	static uint64_t key(const Board& board);
+	// Compares key() with the reference keys of the Polyglot specification; run by selftest
+	static bool checkKeys();
+
+	// All entries stored for a position, in file order
+	vector<Entry> entries(uint64_t key) const;
+
+	// Picks a book move that is in legalMoves. With rng the choice is random in proportion to
+	// the weights, otherwise the highest weight wins. Returns false when out of book.
+	bool probe(const Board& board, const vector<Move>& legalMoves, Move& move, mt19937* rng = nullptr) const;
+
+	// Castling is stored as king-takes-rook (e1h1, e1a1, e8h8, e8a8)
+	static uint16_t encodeMove(const Move& move);
+	static bool decodeMove(uint16_t bookMove, const vector<Move>& legalMoves, Move& move);
+
+	static Entry readEntry(const uint8_t* bytes);
+	static void writeEntry(const Entry& entry, uint8_t* bytes);
+
+private:
+	MappedFile file;
+	const uint8_t* records = nullptr;
+	size_t count = 0;
+};
@@ -0,0 +1,152 @@
+#include "PositionIndex.h"
+#include "ExternalSorter.h"
+#include <thread>
+#include <atomic>
+#include <cstring>
+
+using namespace std;
+
+static const char Magic[8] = { 'C', 'W', 'C', 'I', 'N', 'D', 'E', 'X' };
+
+struct StatsLess {
+	bool operator()(const PositionIndex::MoveStats& a, const PositionIndex::MoveStats& b) const {
+		return a.key != b.key ? a.key < b.key : a.move < b.move;
+	}
+};
+
+struct StatsSame {
+	bool operator()(const PositionIndex::MoveStats& a, const PositionIndex::MoveStats& b) const {
+		return a.key == b.key && a.move == b.move;
+	}
+};
+
+struct StatsCombine {
+	void operator()(PositionIndex::MoveStats& into, const PositionIndex::MoveStats& from) const {
+		into.whiteWins += from.whiteWins;
+		into.draws += from.draws;
+		into.blackWins += from.blackWins;
+		into.games += from.games;
+		into.lastGame = max(into.lastGame, from.lastGame);
+	}
+};
+
+PositionIndex::PositionIndex(const string& path) : file(path) {
+	if (!file.isOpen() || file.size() < sizeof(FileHeader))
+		return;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file.data());
+	if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version)
+		return;
+	if (sizeof(FileHeader) + header->recordCount * sizeof(MoveStats) > file.size())
+		return;
+
+	records = reinterpret_cast<const MoveStats*>(file.data() + sizeof(FileHeader));
+	count = static_cast<size_t>(header->recordCount);
+}
+
+bool PositionIndex::isOpen() const {
+	return records != nullptr;
+}
+
+size_t PositionIndex::recordCount() const {
+	return count;
+}
+
+uint16_t PositionIndex::packMove(const Move& move) {
+	int promo = (move.type == Move::Promotion) ? move.promotionPiece : 0;
+	return static_cast<uint16_t>(move.startSquare | (move.targetSquare << 6) | (promo << 12));
+}
+
+pair<const PositionIndex::MoveStats*, const PositionIndex::MoveStats*> PositionIndex::lookup(uint64_t key) const {
+	const MoveStats* end = records + count;
+	const MoveStats* first = lower_bound(records, end, key, [](const MoveStats& s, uint64_t k) {
+		return s.key < k;
+	});
+	const MoveStats* last = first;
+	while (last != end && last->key == key)
+		++last;
+	return { first, last };
+}
+
+bool PositionIndex::build(const GameStore& store, const string& outputPath, int threads, int maxPly, size_t memoryMb) {
+	threads = max(1, threads);
+	size_t perThread = max<size_t>(1, memoryMb * 1024 * 1024 / sizeof(MoveStats) / threads);
+
+	ExternalSorter<MoveStats, StatsLess, StatsSame, StatsCombine> sorter(outputPath);
+	atomic<size_t> nextGame{ 0 };
+	atomic<bool> failed{ false };
+
+	auto worker = [&]() {
+		Board board;
+		moveGenerator generator;
+		vector<MoveStats> buffer;
+		buffer.reserve(perThread);
+
+		for (size_t g = nextGame++; g < store.gameCount(); g = nextGame++) {
+			GameStore::GameView view = store.game(g);
+			if (!GameStore::startPosition(view, board))
+				continue;
+
+			size_t plies = view.header->plyCount;
+			if (maxPly > 0)
+				plies = min<size_t>(plies, maxPly);
+
+			for (size_t ply = 0; ply < plies; ++ply) {
+				Move m(0, 0);
+				if (!GameStore::decodeMove(board, view.moves[ply], generator, m))
+					break;
+
+				MoveStats s = {};
+				s.key = board.zobristKey;
+				s.move = packMove(m);
+				s.whiteWins = (view.header->result == GameStore::WhiteWins);
+				s.draws = (view.header->result == GameStore::Draw);
+				s.blackWins = (view.header->result == GameStore::BlackWins);
+				s.games = 1;
+				s.lastGame = static_cast<uint32_t>(g);
+				buffer.push_back(s);
+
+				board.makeMove(m, board);
+			}
+
+			if (buffer.size() >= perThread) {
+				// Combining first often shrinks the buffer enough to keep going without a run
+				sorter.sortAndCombine(buffer);
+				if (buffer.size() >= perThread / 2 && !sorter.spill(buffer))
+					failed = true;
+			}
+		}
+		if (!sorter.spill(buffer))
+			failed = true;
+	};
+
+	vector<thread> pool;
+	for (int i = 0; i < threads; ++i)
+		pool.emplace_back(worker);
+	for (auto& t : pool)
+		t.join();
+	if (failed)
+		return false;
+
+	FILE* out = fopen(outputPath.c_str(), "wb");
+	if (!out)
+		return false;
+
+	FileHeader header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	fwrite(&header, sizeof(header), 1, out);
+
+	uint64_t written = 0;
+	bool ok = sorter.merge([&](const MoveStats& s) {
+		fwrite(&s, sizeof(s), 1, out);
+		written++;
+	});
+
+	header.recordCount = written;
+	fseek(out, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, out);
+	ok = ok && ferror(out) == 0;
+	fclose(out);
+	return ok;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Board.h"
+#include "GameStore.h"
+#include "MappedFile.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Opening explorer: for every position reached in a GameStore archive, how often each next
+// move was played and how those games ended. The file is one array of MoveStats sorted by
+// (Board::zobristKey, move), so a lookup is a binary search in the mapped file.
+class PositionIndex {
+public:
+	struct FileHeader {
+		char magic[8];          // "CWCINDEX"
+		uint32_t version;
+		uint32_t reserved;
+		uint64_t recordCount;
+	};
+
+	struct MoveStats {
+		uint64_t key;           // Board::zobristKey before the move
+		uint16_t move;          // from | to << 6 | promotion << 12
+		uint16_t reserved;
+		uint32_t whiteWins;
+		uint32_t draws;
+		uint32_t blackWins;
+		uint32_t games;         // including unknown results
+		uint32_t lastGame;      // one game (GameStore index) where the move was played
+	};
+
+	static_assert(sizeof(MoveStats) == 32, "MoveStats is part of the file format");
+
+	static const uint32_t Version = 1;
+
+	explicit PositionIndex(const string& path);
+
+	bool isOpen() const;
+	size_t recordCount() const;
+
+	// All next-move records for a position (empty if it never occurred); views into the map
+	pair<const MoveStats*, const MoveStats*> lookup(uint64_t key) const;
+
+	static uint16_t packMove(const Move& move);
+
+	// Replays every game on threads and writes the sorted index. Only the first maxPly
+	// plies of each game are indexed (0 = all). memoryMb bounds each thread's buffer.
+	static bool build(const GameStore& store, const string& outputPath, int threads, int maxPly, size_t memoryMb);
+
+private:
+	MappedFile file;
+	const MoveStats* records = nullptr;
+	size_t count = 0;
+};
@@ -0,0 +1,438 @@
+#include "Search.h"
+#include "KpkBitbase.h"
+#include <thread>
+
+using namespace std;
+
+Search::Search() : tt(16) {
+}
+
+void Search::setHashSize(int megabytes) {
+	tt.resize(static_cast<size_t>(max(1, megabytes)));
+}
+
+void Search::setThreads(int count) {
+	threadCount = max(1, count);
+}
+
+void Search::newGame() {
+	tt.clear();
+}
+
+void Search::setTablebases(const TablebaseSet* tables) {
+	tablebases = tables;
+}
+
+void Search::stop() {
+	stopFlag = true;
+}
+
+void Search::ponderHit() {
+	// From here on the clock is ours: count the budget from this moment. Latched, because
+	// the ponderhit can arrive before think() has even started.
+	startMs = nowMs();
+	ponderHitLatched = true;
+	pondering = false;
+}
+
+uint64_t Search::nodes() const {
+	uint64_t total = 0;
+	for (const auto& w : workers)
+		total += w->nodes.load(memory_order_relaxed);
+	return total;
+}
+
+uint64_t Search::tbHits() const {
+	uint64_t total = 0;
+	for (const auto& w : workers)
+		total += w->tbHits.load(memory_order_relaxed);
+	return total;
+}
+
+bool Search::isMateScore(int score) {
+	return abs(score) >= MateScore - MaxMatePlies;
+}
+
+int Search::mateInMoves(int score) {
+	return (score > 0) ? (MateScore - score + 1) / 2 : -(MateScore + score) / 2;
+}
+
+int64_t Search::nowMs() {
+	return chrono::duration_cast<chrono::milliseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Search::allocateTime(int colorToMove) {
+	allocatedMs = 0;
+	if (limits.movetime > 0) {
+		allocatedMs = limits.movetime;
+		return;
+	}
+
+	int timeLeft = (colorToMove == Piece::White) ? limits.wtime : limits.btime;
+	int increment = (colorToMove == Piece::White) ? limits.winc : limits.binc;
+	if (timeLeft < 0)
+		return; // no clock given
+
+	int movesToGo = (limits.movestogo > 0) ? min(limits.movestogo, 40) : 30;
+	int64_t budget = timeLeft / movesToGo + increment * 3 / 4;
+	allocatedMs = max<int64_t>(1, min<int64_t>(budget, timeLeft - 50));
+}
+
+bool Search::shouldStop(Worker& w) {
+	if (stopFlag.load(memory_order_relaxed))
+		return true;
+
+	// Only the main worker enforces limits, helpers follow stopFlag
+	if (w.id != 0 || (w.nodes.load(memory_order_relaxed) & 1023) != 0)
+		return false;
+
+	if (limits.nodes > 0 && nodes() >= limits.nodes)
+		stopFlag = true;
+	else if (allocatedMs > 0 && !pondering && nowMs() - startMs >= allocatedMs)
+		stopFlag = true;
+
+	return stopFlag.load(memory_order_relaxed);
+}
+
+bool Search::isCapture(const Board& board, const Move& move) {
+	return board.Square[move.targetSquare] != Piece::None || move.type == Move::EnPassant;
+}
+
+bool Search::inCheck(Board& board, int color) {
+	int kingSq = board.findKingSquare(color);
+	return kingSq != -1 && board.isSquareAttacked(kingSq, Piece::GetOpponentColor(color), board);
+}
+
+bool Search::isRepetition(Worker& w, int ply) const {
+	uint64_t hash = w.hashStack[ply];
+
+	// Positions reached inside the search, same side to move, within the fifty-move window
+	int reach = min(ply, w.board.halfmoveClock);
+	for (int i = ply - 2; i >= ply - reach && i >= 0; i -= 2) {
+		if (w.hashStack[i] == hash)
+			return true;
+	}
+
+	// Positions from the game itself
+	auto it = w.board.repetitionMap.find(hash);
+	return it != w.board.repetitionMap.end() && it->second > 0;
+}
+
+bool Search::probeTablebase(Worker& w, int ply, int& score) {
+	if (!tablebases || w.board.pieceTotal > tablebases->maxPieces())
+		return false;
+
+	// Each thread keeps its own cache, so nothing here is shared but the read-only tables
+	TablebaseCacheEntry& cached = w.tbCache[w.board.zobristKey % TablebaseCacheSize];
+	uint8_t value;
+	if (cached.key == w.board.zobristKey) {
+		value = cached.value;
+	}
+	else {
+		value = tablebases->probe(w.board);
+		cached.key = w.board.zobristKey;
+		cached.value = value;
+	}
+	if (value == Tablebase::Invalid)
+		return false;
+
+	w.tbHits.fetch_add(1, memory_order_relaxed);
+	if (Tablebase::isWin(value))
+		score = MateScore - ply - Tablebase::pliesToMate(value);
+	else if (Tablebase::isLoss(value))
+		score = -MateScore + ply + Tablebase::pliesToMate(value);
+	else
+		score = 0;
+	return true;
+}
+
+void Search::orderMoves(Worker& w, vector<Move>& moves, uint16_t ttMove, int ply) {
+	vector<pair<int, int>> scored;
+	scored.reserve(moves.size());
+
+	for (int i = 0; i < (int)moves.size(); ++i) {
+		const Move& m = moves[i];
+		uint16_t packed = TranspositionTable::packMove(m);
+		int score = 0;
+
+		if (packed == ttMove) {
+			score = 1000000;
+		}
+		else if (isCapture(w.board, m)) {
+			int victim = (m.type == Move::EnPassant) ? Piece::Pawn : Piece::Type(w.board.Square[m.targetSquare]);
+			int attacker = Piece::Type(w.board.Square[m.startSquare]);
+			score = 100000 + Evaluation::PieceValues[victim] * 10 - Evaluation::PieceValues[attacker] / 10;
+		}
+		else if (m.type == Move::Promotion) {
+			score = 90000 + Evaluation::PieceValues[m.promotionPiece];
+		}
+		else if (ply < MaxPly && (packed == w.killers[ply][0] || packed == w.killers[ply][1])) {
+			score = 80000;
+		}
+		else {
+			score = w.history[m.startSquare][m.targetSquare];
+		}
+
+		scored.push_back({ score, i });
+	}
+
+	stable_sort(scored.begin(), scored.end(), [](const pair<int, int>& a, const pair<int, int>& b) {
+		return a.first > b.first;
+	});
+
+	vector<Move> ordered;
+	ordered.reserve(moves.size());
+	for (auto& s : scored)
+		ordered.push_back(moves[s.second]);
+	moves.swap(ordered);
+}
+
+int Search::quiesce(Worker& w, int alpha, int beta, int ply) {
+	w.nodes.fetch_add(1, memory_order_relaxed);
+	if (shouldStop(w))
+		return 0;
+
+	int standPat = Evaluation::evaluate(w.board);
+	if (ply >= MaxPly)
+		return standPat;
+	if (standPat >= beta)
+		return standPat;
+	if (standPat > alpha)
+		alpha = standPat;
+
+	vector<Move> moves = w.generator.GenerateMoves(&w.board, moveGenerator::Captures);
+	moves.erase(remove_if(moves.begin(), moves.end(), [&](const Move& m) {
+		return !isCapture(w.board, m) && !(m.type == Move::Promotion && m.promotionPiece == Piece::Queen);
+	}), moves.end());
+	orderMoves(w, moves, 0, MaxPly);
+
+	int us = w.board.colorToMove;
+	for (Move& m : moves) {
+		w.board.makeMove(m, w.board);
+		if (inCheck(w.board, us)) {
+			w.board.undoMove(m);
+			continue;
+		}
+
+		int score = -quiesce(w, -beta, -alpha, ply + 1);
+		w.board.undoMove(m);
+
+		if (stopFlag.load(memory_order_relaxed))
+			return 0;
+		if (score >= beta)
+			return score;
+		if (score > alpha)
+			alpha = score;
+	}
+
+	return alpha;
+}
+
+int Search::alphaBeta(Worker& w, int depth, int alpha, int beta, int ply) {
+	w.pv[ply].clear();
+
+	if (ply > 0) {
+		w.nodes.fetch_add(1, memory_order_relaxed);
+		if (shouldStop(w))
+			return 0;
+		if (w.board.halfmoveClock >= 100 || isRepetition(w, ply))
+			return 0;
+
+		// Tablebase scores are exact: no need to search below them
+		int tbScore;
+		if (probeTablebase(w, ply, tbScore))
+			return tbScore;
+
+		// Dead positions and K+P v K draws are exact too; wins are left to the search, guided by the evaluation
+		if (w.board.pieceTotal <= 4 && w.board.hasInsufficientMaterial())
+			return 0;
+		bool pawnSideWins;
+		if (w.board.pieceTotal == 3 && KpkBitbase::probe(w.board, pawnSideWins) && !pawnSideWins)
+			return 0;
+	}
+	if (ply >= MaxPly - 1)
+		return Evaluation::evaluate(w.board);
+
+	int us = w.board.colorToMove;
+	bool checked = inCheck(w.board, us);
+	if (checked)
+		depth++;
+
+	if (depth <= 0)
+		return quiesce(w, alpha, beta, ply);
+
+	uint64_t hash = w.hashStack[ply];
+	TranspositionTable::Entry entry;
+	uint16_t ttMove = 0;
+	if (tt.probe(hash, entry)) {
+		ttMove = entry.move;
+		if (ply > 0 && entry.depth >= depth) {
+			// Mate scores are stored relative to the node, convert back to the root
+			int score = entry.score;
+			if (score >= MateScore - MaxMatePlies) score -= ply;
+			else if (score <= -MateScore + MaxMatePlies) score += ply;
+
+			if (entry.bound == TranspositionTable::Exact)
+				return score;
+			if (entry.bound == TranspositionTable::LowerBound && score >= beta)
+				return score;
+			if (entry.bound == TranspositionTable::UpperBound && score <= alpha)
+				return score;
+		}
+	}
+
+	vector<Move> moves = (ply == 0) ? rootMoves
+		: checked ? w.generator.GenerateEvasions(&w.board) : w.generator.GenerateMoves(&w.board);
+	orderMoves(w, moves, ttMove, ply);
+
+	int originalAlpha = alpha;
+	int bestScore = -Infinity;
+	uint16_t bestMove = 0;
+	int legalCount = 0;
+
+	for (Move& m : moves) {
+		w.board.makeMove(m, w.board);
+		if (inCheck(w.board, us)) {
+			w.board.undoMove(m);
+			continue;
+		}
+		legalCount++;
+		w.hashStack[ply + 1] = w.board.zobristKey;
+
+		int score;
+		if (legalCount == 1) {
+			score = -alphaBeta(w, depth - 1, -beta, -alpha, ply + 1);
+		}
+		else {
+			// Principal variation search: prove the move is worse with a null window first
+			score = -alphaBeta(w, depth - 1, -alpha - 1, -alpha, ply + 1);
+			if (score > alpha && score < beta)
+				score = -alphaBeta(w, depth - 1, -beta, -alpha, ply + 1);
+		}
+		w.board.undoMove(m);
+
+		if (stopFlag.load(memory_order_relaxed))
+			return 0;
+
+		if (score > bestScore) {
+			bestScore = score;
+			bestMove = TranspositionTable::packMove(m);
+
+			if (score > alpha) {
+				alpha = score;
+				w.pv[ply].clear();
+				w.pv[ply].push_back(m);
+				w.pv[ply].insert(w.pv[ply].end(), w.pv[ply + 1].begin(), w.pv[ply + 1].end());
+			}
+		}
+
+		if (alpha >= beta) {
+			if (!isCapture(w.board, m) && m.type != Move::Promotion) {
+				if (w.killers[ply][0] != bestMove) {
+					w.killers[ply][1] = w.killers[ply][0];
+					w.killers[ply][0] = bestMove;
+				}
+				w.history[m.startSquare][m.targetSquare] += depth * depth;
+			}
+			break;
+		}
+	}
+
+	if (legalCount == 0)
+		return checked ? -MateScore + ply : 0;
+
+	TranspositionTable::Bound bound = (bestScore >= beta) ? TranspositionTable::LowerBound
+		: (bestScore > originalAlpha) ? TranspositionTable::Exact : TranspositionTable::UpperBound;
+	int stored = bestScore;
+	if (stored >= MateScore - MaxMatePlies) stored += ply;
+	else if (stored <= -MateScore + MaxMatePlies) stored -= ply;
+	tt.store(hash, depth, stored, bound, bestMove);
+
+	return bestScore;
+}
+
+void Search::iterate(Worker& w, function<void(const SearchInfo&)> onInfo, Move& bestMove) {
+	int maxDepth = (limits.depth > 0) ? min(limits.depth, MaxPly - 1) : MaxPly - 1;
+
+	// Helpers start one ply deeper every other thread so they don't all walk the same tree
+	for (int depth = 1 + (w.id % 2); depth <= maxDepth; ++depth) {
+		int score = alphaBeta(w, depth, -Infinity, Infinity, 0);
+
+		if (stopFlag.load(memory_order_relaxed) && depth > 1)
+			break;
+		if (w.id != 0)
+			continue;
+
+		if (!w.pv[0].empty())
+			bestMove = w.pv[0][0];
+
+		if (onInfo) {
+			SearchInfo info;
+			info.depth = depth;
+			info.score = score;
+			info.nodes = nodes();
+			info.tbHits = tbHits();
+			info.timeMs = nowMs() - startMs;
+			info.pv = w.pv[0];
+			onInfo(info);
+		}
+
+		if (stopFlag.load(memory_order_relaxed))
+			break;
+
+		// Not worth starting an iteration we probably can't finish
+		if (allocatedMs > 0 && !pondering && !limits.infinite && nowMs() - startMs > allocatedMs / 2)
+			break;
+		if (isMateScore(score) && limits.depth == 0 && !limits.infinite && depth > mateInMoves(abs(score)) * 2 + 1)
+			break;
+	}
+}
+
+Move Search::think(const Board& board, const SearchLimits& searchLimits, function<void(const SearchInfo&)> onInfo) {
+	limits = searchLimits;
+	stopFlag = false;
+	startMs = nowMs();
+	// Set pondering before looking at the latch: a ponderHit() in between then clears it
+	pondering = limits.ponder;
+	if (ponderHitLatched)
+		pondering = false;
+	allocateTime(board.colorToMove);
+
+	workers.clear();
+	for (int i = 0; i < threadCount; ++i) {
+		auto w = make_unique<Worker>();
+		w->board = board;
+		w->id = i;
+		w->pv.assign(MaxPly + 1, vector<Move>());
+		w->hashStack[0] = w->board.zobristKey;
+		workers.push_back(move(w));
+	}
+
+	// Fallback so we always answer with a legal move, even if stopped at once
+	rootMoves = workers[0]->generator.GenerateLegalMoves(&workers[0]->board);
+	if (tablebases && board.pieceTotal <= tablebases->maxPieces())
+		tablebases->filterRootMoves(workers[0]->board, rootMoves);
+	Move bestMove = rootMoves.empty() ? Move(0, 0) : rootMoves[0];
+
+	if (!rootMoves.empty()) {
+		vector<thread> helpers;
+		vector<Move> helperBest(threadCount, bestMove);
+		for (int i = 1; i < threadCount; ++i)
+			helpers.emplace_back([this, i, &helperBest]() { iterate(*workers[i], nullptr, helperBest[i]); });
+
+		iterate(*workers[0], onInfo, bestMove);
+
+		// infinite and ponder searches only finish when told to
+		while ((limits.infinite || pondering) && !stopFlag)
+			this_thread::sleep_for(chrono::milliseconds(1));
+
+		stopFlag = true;
+		for (auto& t : helpers)
+			t.join();
+	}
+
+	ponderHitLatched = false;
+	pondering = false;
+	return bestMove;
+}
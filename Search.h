@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Board.h"
+#include "moveGenerator.h"
+#include "Evaluation.h"
+#include "TranspositionTable.h"
+#include "TablebaseSet.h"
+#include "useFullStuff.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+using namespace std;
+
+struct SearchLimits {
+	int depth = 0;          // 0 = no depth limit
+	uint64_t nodes = 0;     // 0 = no node limit
+	int movetime = 0;       // milliseconds, 0 = not set
+	int wtime = -1, btime = -1;
+	int winc = 0, binc = 0;
+	int movestogo = 0;
+	bool infinite = false;
+	bool ponder = false;
+};
+
+struct SearchInfo {
+	int depth = 0;
+	int score = 0;          // centipawns, or a mate score (see Search::isMateScore)
+	uint64_t nodes = 0;
+	uint64_t tbHits = 0;
+	int64_t timeMs = 0;
+	vector<Move> pv;
+};
+
+class Search {
+public:
+	static const int Infinity = 32000;
+	static const int MateScore = 31000;
+	static const int MaxPly = 64;
+	// Mates found in the search plus the longest distance a tablebase can report
+	static const int MaxMatePlies = MaxPly + Tablebase::MaxPlies;
+
+	Search();
+
+	void setHashSize(int megabytes);
+	void setThreads(int count);
+	void newGame();
+	// Tables probed once the board has few enough pieces; nullptr turns probing off.
+	// Must stay open and unchanged while think() runs.
+	void setTablebases(const TablebaseSet* tables);
+
+	// Iterative deepening on a copy of board. Runs until a limit is hit or stop() is called;
+	// with infinite/ponder limits it keeps waiting for stop()/ponderHit() before returning.
+	Move think(const Board& board, const SearchLimits& limits, function<void(const SearchInfo&)> onInfo = nullptr);
+	void stop();
+	void ponderHit();
+
+	uint64_t nodes() const;
+	uint64_t tbHits() const;
+	static bool isMateScore(int score);
+	static int mateInMoves(int score);
+
+private:
+	struct TablebaseCacheEntry {
+		uint64_t key = 0;
+		uint8_t value = Tablebase::Invalid;
+	};
+	static const int TablebaseCacheSize = 4096;
+
+	struct Worker {
+		Board board;
+		moveGenerator generator;
+		uint64_t hashStack[MaxPly + 1];
+		uint16_t killers[MaxPly][2] = {};
+		int history[64][64] = {};
+		vector<vector<Move>> pv;
+		atomic<uint64_t> nodes{ 0 };
+		atomic<uint64_t> tbHits{ 0 };
+		TablebaseCacheEntry tbCache[TablebaseCacheSize];
+		int id = 0;
+	};
+
+	TranspositionTable tt;
+	const TablebaseSet* tablebases = nullptr;
+	vector<Move> rootMoves;     // moves searched at the root, tablebase-filtered when possible
+	int threadCount = 1;
+	atomic<bool> stopFlag{ false };
+	atomic<bool> pondering{ false };
+	atomic<bool> ponderHitLatched{ false };  // ponderHit() seen during this go, kept for think()
+	atomic<int64_t> startMs{ 0 };
+	SearchLimits limits;
+	int64_t allocatedMs = 0;
+	vector<unique_ptr<Worker>> workers;
+
+	static int64_t nowMs();
+	void allocateTime(int colorToMove);
+	bool shouldStop(Worker& w);
+
+	void iterate(Worker& w, function<void(const SearchInfo&)> onInfo, Move& bestMove);
+	int alphaBeta(Worker& w, int depth, int alpha, int beta, int ply);
+	int quiesce(Worker& w, int alpha, int beta, int ply);
+	bool isRepetition(Worker& w, int ply) const;
+	bool probeTablebase(Worker& w, int ply, int& score);
+	bool inCheck(Board& board, int color);
+	void orderMoves(Worker& w, vector<Move>& moves, uint16_t ttMove, int ply);
+	static bool isCapture(const Board& board, const Move& move);
+};
@@ -0,0 +1,229 @@
+#include "Tablebase.h"
+#include <cstring>
+
+using namespace std;
+
+static const char Magic[8] = { 'C', 'W', 'C', 'T', 'B', 'A', 'S', 'E' };
+
+// Letters in table order, strongest first
+static const string PieceLetters = "KQRBNP";
+
+// a1-d1-d4 triangle in index order
+static const int TriangleSquares[10] = { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+
+static int letterType(char c) {
+	switch (c) {
+	case 'K': return Piece::King;
+	case 'Q': return Piece::Queen;
+	case 'R': return Piece::Rook;
+	case 'B': return Piece::Bishop;
+	case 'N': return Piece::Knight;
+	case 'P': return Piece::Pawn;
+	default: return Piece::None;
+	}
+}
+
+static char typeLetter(int type) {
+	return "?PNBRQK"[type];
+}
+
+// Fixed values, not Evaluation's: tuning the evaluation must not rename table files
+static int sideStrength(const string& side) {
+	static const int Values[7] = { 0, 1, 3, 3, 5, 9, 0 };
+	int total = 0;
+	for (char c : side)
+		total += Values[letterType(c)];
+	return total;
+}
+
+Tablebase::Tablebase(const string& material) {
+	setMaterial(material);
+}
+
+// Sorts one side's letters into table order; empty if it is not one king plus pieces
+static string sortSide(string side) {
+	for (char& c : side)
+		c = static_cast<char>(toupper(c));
+	if (count(side.begin(), side.end(), 'K') != 1)
+		return "";
+	for (char c : side) {
+		if (PieceLetters.find(c) == string::npos)
+			return "";
+	}
+	sort(side.begin(), side.end(), [](char a, char b) {
+		return PieceLetters.find(a) < PieceLetters.find(b);
+	});
+	return side;
+}
+
+string Tablebase::canonical(const string& material, bool* flipped) {
+	size_t v = material.find_first_of("vV");
+	if (v == string::npos)
+		return "";
+	string white = sortSide(material.substr(0, v));
+	string black = sortSide(material.substr(v + 1));
+	if (white.empty() || black.empty())
+		return "";
+
+	// The stronger side goes first; equal strength is ordered by the pieces themselves
+	int ws = sideStrength(white), bs = sideStrength(black);
+	bool swap = ws < bs;
+	if (ws == bs) {
+		swap = lexicographical_compare(black.begin(), black.end(), white.begin(), white.end(), [](char a, char b) {
+			return PieceLetters.find(a) < PieceLetters.find(b);
+		});
+	}
+
+	if (flipped)
+		*flipped = swap;
+	return swap ? black + "v" + white : white + "v" + black;
+}
+
+string Tablebase::materialOf(const Board& board, bool* flipped) {
+	string white = "K", black = "K";
+	for (int square = 0; square < 64; ++square) {
+		int piece = board.Square[square];
+		int type = Piece::Type(piece);
+		if (type == Piece::None || type == Piece::King)
+			continue;
+		(Piece::IsColor(piece, Piece::White) ? white : black) += typeLetter(type);
+	}
+	return canonical(white + "v" + black, flipped);
+}
+
+bool Tablebase::setMaterial(const string& material) {
+	string canon = canonical(material);
+	if (canon.empty() || canon.size() - 1 > MaxPieces)
+		return false;
+
+	name = canon;
+	pieces = { Piece::WhiteKing, Piece::BlackKing };
+	size_t v = name.find('v');
+	for (size_t i = 1; i < name.size(); ++i) {
+		if (i == v || i == v + 1)
+			continue;
+		pieces.push_back(Piece::MakePiece(i < v ? Piece::White : Piece::Black, letterType(name[i])));
+	}
+
+	pawns = name.find('P') != string::npos;
+	kingSquares = pawns ? 32 : 10;
+	size = kingSquares;
+	for (size_t i = 1; i < pieces.size(); ++i)
+		size *= 64;
+	return true;
+}
+
+// Identical pieces (the two knights of KNNvK) are kept in ascending square order
+static void sortDuplicates(const vector<int>& pieces, int s[]) {
+	for (size_t i = 3; i < pieces.size(); ++i) {
+		if (pieces[i] == pieces[i - 1] && s[i] < s[i - 1])
+			swap(s[i], s[i - 1]);
+	}
+}
+
+uint64_t Tablebase::indexOf(const int squares[], int colorToMove) const {
+	int n = pieceCount();
+	int s[MaxPieces] = {};
+	for (int i = 0; i < n; ++i)
+		s[i] = squares[i];
+
+	// Mirror so the white king ends up on files a-d (and, without pawns, ranks 1-4 below the diagonal)
+	if (s[0] % 8 > 3) {
+		for (int i = 0; i < n; ++i)
+			s[i] ^= 7;
+	}
+
+	uint64_t index;
+	if (pawns) {
+		sortDuplicates(pieces, s);
+		index = (s[0] / 8) * 4 + s[0] % 8;
+	}
+	else {
+		if (s[0] / 8 > 3) {
+			for (int i = 0; i < n; ++i)
+				s[i] ^= 56;
+		}
+
+		int t[MaxPieces] = {};
+		for (int i = 0; i < n; ++i)
+			t[i] = (s[i] % 8) * 8 + s[i] / 8;
+		sortDuplicates(pieces, s);
+		sortDuplicates(pieces, t);
+
+		// With the king on the diagonal both orientations are in the triangle: take the smaller
+		if (s[0] / 8 > s[0] % 8 || (s[0] / 8 == s[0] % 8 && lexicographical_compare(t + 1, t + n, s + 1, s + n))) {
+			for (int i = 0; i < n; ++i)
+				s[i] = t[i];
+		}
+		index = find(TriangleSquares, TriangleSquares + 10, s[0]) - TriangleSquares;
+	}
+
+	for (int i = 1; i < n; ++i)
+		index = index * 64 + s[i];
+	return (colorToMove == Piece::White ? 0 : size) + index;
+}
+
+void Tablebase::squaresOf(uint64_t index, int squares[], int& colorToMove) const {
+	colorToMove = index < size ? Piece::White : Piece::Black;
+	uint64_t rest = index % size;
+	for (int i = pieceCount() - 1; i >= 1; --i) {
+		squares[i] = static_cast<int>(rest % 64);
+		rest /= 64;
+	}
+	squares[0] = pawns ? static_cast<int>((rest / 4) * 8 + rest % 4) : TriangleSquares[rest];
+}
+
+bool Tablebase::index(const Board& board, uint64_t& index) const {
+	bool flipped;
+	if (name.empty() || materialOf(board, &flipped) != name)
+		return false;
+
+	int squares[MaxPieces];
+	bool used[MaxPieces] = {};
+	for (int square = 0; square < 64; ++square) {
+		int piece = board.Square[square];
+		if (piece == Piece::None)
+			continue;
+
+		// Flipping swaps the colours (bit 8) and mirrors the ranks
+		int code = flipped ? (piece ^ Piece::Black) : piece;
+		int tableSquare = flipped ? (square ^ 56) : square;
+		for (int j = 0; j < pieceCount(); ++j) {
+			if (!used[j] && pieces[j] == code) {
+				used[j] = true;
+				squares[j] = tableSquare;
+				break;
+			}
+		}
+	}
+
+	int colorToMove = flipped ? Piece::GetOpponentColor(board.colorToMove) : board.colorToMove;
+	index = indexOf(squares, colorToMove);
+	return true;
+}
+
+bool Tablebase::open(const string& path) {
+	values = nullptr;
+	if (!file.open(path) || file.size() < sizeof(FileHeader))
+		return false;
+
+	const FileHeader* header = reinterpret_cast<const FileHeader*>(file.data());
+	if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version)
+		return false;
+
+	string material(header->material, strnlen(header->material, sizeof(header->material)));
+	if ((name.empty() && !setMaterial(material)) || material != name)
+		return false;
+	if (header->positions != size || file.size() < sizeof(FileHeader) + 2 * size)
+		return false;
+
+	values = reinterpret_cast<const uint8_t*>(file.data() + sizeof(FileHeader));
+	return true;
+}
+
+uint8_t Tablebase::probe(const Board& board) const {
+	uint64_t i;
+	if (!isOpen() || !index(board, i))
+		return Invalid;
+	return values[i];
+}
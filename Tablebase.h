@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Board.h"
+#include "MappedFile.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Distance-to-mate table for one material set with up to MaxPieces pieces ("KQvK", "KBNvK",
+// "KQvKR"...). The side named first is white in the table; boards with the colours the
+// other way round are flipped before indexing. Castling and en passant are ignored.
+//
+// Every position takes one byte per side to move: 0 draw, 255 not a legal position,
+// otherwise plies to mate + 1 (odd plies: the side to move mates, even: it gets mated).
+// Positions are reduced by symmetry: without pawns the white king is moved into the
+// a1-d1-d4 triangle (10 squares), with pawns it is mirrored onto files a-d (32 squares).
+// Index slots that are not the chosen form of their position are stored as Invalid.
+//
+// File layout (little endian): FileHeader, then positions() bytes with white to move and
+// positions() bytes with black to move.
+class Tablebase {
+public:
+	static const int MaxPieces = 4;
+
+	static const uint8_t Draw = 0;
+	static const uint8_t Invalid = 255;
+	static const int MaxPlies = 250;
+
+	struct FileHeader {
+		char magic[8];          // "CWCTBASE"
+		uint32_t version;
+		uint32_t pieceCount;
+		char material[16];      // zero padded
+		uint64_t positions;     // per side to move
+	};
+
+	static const uint32_t Version = 1;
+
+	static bool isWin(uint8_t value) { return value != Draw && value != Invalid && value % 2 == 0; }
+	static bool isLoss(uint8_t value) { return value != Draw && value != Invalid && value % 2 == 1; }
+	static int pliesToMate(uint8_t value) { return value - 1; }
+	static uint8_t fromPlies(int plies) { return static_cast<uint8_t>(plies + 1); }
+
+	Tablebase() = default;
+	explicit Tablebase(const string& material);
+
+	Tablebase(const Tablebase&) = delete;
+	Tablebase& operator=(const Tablebase&) = delete;
+
+	// Accepts either colour order; the stored name is the canonical one
+	bool setMaterial(const string& material);
+	const string& material() const { return name; }
+	int pieceCount() const { return static_cast<int>(pieces.size()); }
+	bool hasPawns() const { return pawns; }
+	uint64_t positions() const { return size; }
+
+	// Table piece codes in index order: white king, black king, white pieces, black pieces
+	const vector<int>& pieceCodes() const { return pieces; }
+
+	// Canonical material name of a board ("KRvKN"), and whether its colours must be swapped
+	static string materialOf(const Board& board, bool* flipped = nullptr);
+	static string canonical(const string& material, bool* flipped = nullptr);
+	static string fileName(const string& material) { return material + ".cwtb"; }
+
+	// squares[] in pieceCodes() order, already in table colours. Index includes the side to move.
+	uint64_t indexOf(const int squares[], int colorToMove) const;
+	void squaresOf(uint64_t index, int squares[], int& colorToMove) const;
+	bool index(const Board& board, uint64_t& index) const;
+
+	bool open(const string& path);
+	bool isOpen() const { return values != nullptr; }
+	uint8_t value(uint64_t index) const { return values[index]; }
+
+	// Value for the board's side to move, Invalid if the board is not of this material
+	uint8_t probe(const Board& board) const;
+
+private:
+	string name;
+	vector<int> pieces;
+	bool pawns = false;
+	int kingSquares = 0;
+	uint64_t size = 0;
+
+	MappedFile file;
+	const uint8_t* values = nullptr;
+};
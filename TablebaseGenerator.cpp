@@ -0,0 +1,407 @@
+#include "TablebaseGenerator.h"
+#include <atomic>
+#include <thread>
+#include <map>
+#include <set>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+using namespace std;
+
+// Working values besides the Tablebase encoding
+static const uint8_t Unknown = 254;
+static const uint8_t NoExit = 253;
+static const uint8_t NoPending = 255;
+
+static void parallelFor(uint64_t total, int threads, const function<void(uint64_t begin, uint64_t end, int thread)>& body) {
+	const uint64_t chunk = 1 << 14;
+	atomic<uint64_t> next{ 0 };
+	vector<thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.emplace_back([&, t]() {
+			for (uint64_t begin = next.fetch_add(chunk); begin < total; begin = next.fetch_add(chunk))
+				body(begin, min(total, begin + chunk), t);
+		});
+	}
+	for (auto& t : pool)
+		t.join();
+}
+
+static void atomicMin(atomic<uint8_t>& target, uint8_t value) {
+	uint8_t current = target.load();
+	while (value < current && !target.compare_exchange_weak(current, value)) {}
+}
+
+static void atomicMax(atomic<int>& target, int value) {
+	int current = target.load();
+	while (value > current && !target.compare_exchange_weak(current, value)) {}
+}
+
+// Orders values from the side to move's view: quick wins, slow wins, draws, slow losses, quick losses
+static int preference(uint8_t value) {
+	if (Tablebase::isWin(value)) return 1000 - Tablebase::pliesToMate(value);
+	if (Tablebase::isLoss(value)) return -1000 + Tablebase::pliesToMate(value);
+	return 0;
+}
+
+// The value of a child position (its side to move's view) seen from the side that moved into it
+static uint8_t backUp(uint8_t child) {
+	if (child == Tablebase::Draw || child == Tablebase::Invalid)
+		return Tablebase::Draw;
+	return Tablebase::fromPlies(min(Tablebase::pliesToMate(child) + 1, Tablebase::MaxPlies));
+}
+
+static string materialName(const vector<int>& codes) {
+	string white = "K", black = "K";
+	for (size_t i = 2; i < codes.size(); ++i)
+		(Piece::IsColor(codes[i], Piece::White) ? white : black) += "?PNBRQK"[Piece::Type(codes[i])];
+	return Tablebase::canonical(white + "v" + black);
+}
+
+// Materials one capture and/or promotion away
+static set<string> exitMaterials(const Tablebase& table) {
+	const vector<int>& codes = table.pieceCodes();
+	set<string> result;
+	auto add = [&](const vector<int>& c) {
+		string m = materialName(c);
+		if (m != "KvK")
+			result.insert(m);
+	};
+
+	for (size_t i = 2; i < codes.size(); ++i) {
+		vector<int> c = codes;
+		c.erase(c.begin() + i);
+		add(c);
+	}
+
+	for (size_t p = 2; p < codes.size(); ++p) {
+		if (Piece::Type(codes[p]) != Piece::Pawn)
+			continue;
+		for (int promotion : { Piece::Queen, Piece::Rook, Piece::Bishop, Piece::Knight }) {
+			vector<int> promoted = codes;
+			promoted[p] = Piece::MakePiece(Piece::GetColor(codes[p]), promotion);
+			add(promoted);
+			for (size_t i = 2; i < codes.size(); ++i) {
+				if (i == p || Piece::GetColor(codes[i]) == Piece::GetColor(codes[p]))
+					continue;
+				vector<int> c = promoted;
+				c.erase(c.begin() + i);
+				add(c);
+			}
+		}
+	}
+	return result;
+}
+
+// Sets board up from table squares; false for overlapping pieces or pawns on the back ranks
+static bool placePieces(const Tablebase& table, const int squares[], int colorToMove, Board& board) {
+	const vector<int>& codes = table.pieceCodes();
+	for (int square = 0; square < 64; ++square)
+		board.Square[square] = Piece::None;
+
+	for (size_t i = 0; i < codes.size(); ++i) {
+		int square = squares[i];
+		if (board.Square[square] != Piece::None)
+			return false;
+		if (Piece::Type(codes[i]) == Piece::Pawn && (square < 8 || square >= 56))
+			return false;
+		board.Square[square] = codes[i];
+	}
+
+	board.colorToMove = colorToMove;
+	board.enPassantSquare = -1;
+	board.whiteKingMoved = board.blackKingMoved = true;
+	board.whiteKingsideRookMoved = board.whiteQueensideRookMoved = true;
+	board.blackKingsideRookMoved = board.blackQueensideRookMoved = true;
+	board.castlingRights.whiteKingside = board.castlingRights.whiteQueenside = false;
+	board.castlingRights.blackKingside = board.castlingRights.blackQueenside = false;
+	board.kingSquares[0] = squares[0];
+	board.kingSquares[1] = squares[1];
+	board.halfmoveClock = 0;
+	board.computeMaterial();
+	return true;
+}
+
+// Squares a piece standing on square could have come from with a quiet move
+static void unmoveTargets(int piece, int square, uint64_t occupied, vector<int>& targets) {
+	targets.clear();
+	auto empty = [&](int s) { return !(occupied >> s & 1); };
+
+	switch (Piece::Type(piece)) {
+	case Piece::Pawn: {
+		int back = Piece::IsColor(piece, Piece::White) ? -8 : 8;
+		int rank = square / 8;
+		bool canStepBack = Piece::IsColor(piece, Piece::White) ? rank >= 2 : rank <= 5;
+		bool doubleRank = Piece::IsColor(piece, Piece::White) ? rank == 3 : rank == 4;
+		if (canStepBack && empty(square + back)) {
+			targets.push_back(square + back);
+			if (doubleRank && empty(square + 2 * back))
+				targets.push_back(square + 2 * back);
+		}
+		break;
+	}
+	case Piece::Knight:
+		for (int s : PrecomputedMoveData::knightMoves[square])
+			if (empty(s)) targets.push_back(s);
+		break;
+	case Piece::King:
+		for (int s : PrecomputedMoveData::kingMoves[square])
+			if (empty(s)) targets.push_back(s);
+		break;
+	default: {
+		int first = (Piece::Type(piece) == Piece::Bishop) ? 4 : 0;
+		int last = (Piece::Type(piece) == Piece::Rook) ? 4 : 8;
+		for (int dir = first; dir < last; ++dir) {
+			for (int n = 1; n <= PrecomputedMoveData::NumSquaresToEdge[square][dir]; ++n) {
+				int s = square + PrecomputedMoveData::DirectionOffsets[dir] * n;
+				if (!empty(s))
+					break;
+				targets.push_back(s);
+			}
+		}
+		break;
+	}
+	}
+}
+
+vector<string> TablebaseGenerator::allMaterials(int pieceCount) {
+	const string letters = "QRBNP";
+	set<string> result;
+
+	// Every multiset of extra pieces, and every way to hand them to the two sides
+	function<void(string, size_t, int)> build = [&](string extras, size_t from, int left) {
+		if (left > 0) {
+			for (size_t i = from; i < letters.size(); ++i)
+				build(extras + letters[i], i, left - 1);
+			return;
+		}
+		for (int mask = 0; mask < (1 << extras.size()); ++mask) {
+			string white = "K", black = "K";
+			for (size_t i = 0; i < extras.size(); ++i)
+				((mask >> i & 1) ? black : white) += extras[i];
+			result.insert(Tablebase::canonical(white + "v" + black));
+		}
+	};
+	build("", 0, pieceCount - 2);
+
+	result.erase("KvK");
+	return vector<string>(result.begin(), result.end());
+}
+
+bool TablebaseGenerator::generate(const string& material, const string& directory, int threads) {
+	Tablebase table;
+	if (!table.setMaterial(material) || table.pieceCount() < 3)
+		return false;
+	threads = max(1, threads);
+
+	// Smaller tables reached by captures and promotions, generated first when missing
+	map<string, unique_ptr<Tablebase>> exits;
+	for (const string& m : exitMaterials(table)) {
+		string path = directory + "/" + Tablebase::fileName(m);
+		auto sub = make_unique<Tablebase>(m);
+		if (!sub->open(path) && (!generate(m, directory, threads) || !sub->open(path)))
+			return false;
+		exits[m] = std::move(sub);
+	}
+
+	auto started = chrono::steady_clock::now();
+	uint64_t total = 2 * table.positions();
+	vector<uint8_t> value(total, Unknown);
+	vector<uint8_t> exitValue(total, NoExit);
+	vector<atomic<uint8_t>> children(total);      // in-table successors not yet known to win
+	vector<atomic<uint8_t>> pendingWin(total);    // plies of the quickest win found so far
+	vector<atomic<uint8_t>> pendingLoss(total);   // plies of the loss once every move loses
+	for (uint64_t i = 0; i < total; ++i) {
+		pendingWin[i].store(NoPending, memory_order_relaxed);
+		pendingLoss[i].store(NoPending, memory_order_relaxed);
+	}
+	atomic<int> highestPending{ 0 };
+
+	// Pass 1: legal moves of every position, mates, stalemates and moves that leave the table
+	struct Scratch {
+		Board board;
+		moveGenerator generator;
+		vector<uint64_t> successors;
+		vector<int> targets;
+	};
+	vector<unique_ptr<Scratch>> scratch;
+	for (int t = 0; t < threads; ++t)
+		scratch.push_back(make_unique<Scratch>());
+
+	parallelFor(total, threads, [&](uint64_t begin, uint64_t end, int t) {
+		Board& board = scratch[t]->board;
+		vector<uint64_t>& successors = scratch[t]->successors;
+		int squares[Tablebase::MaxPieces];
+		int colorToMove;
+
+		for (uint64_t i = begin; i < end; ++i) {
+			table.squaresOf(i, squares, colorToMove);
+			int them = Piece::GetOpponentColor(colorToMove);
+			if (table.indexOf(squares, colorToMove) != i || !placePieces(table, squares, colorToMove, board) ||
+				board.isSquareAttacked(board.findKingSquare(them), colorToMove, board)) {
+				value[i] = Tablebase::Invalid;
+				continue;
+			}
+
+			int legalMoves = 0;
+			uint8_t bestExit = NoExit;
+			successors.clear();
+			for (Move& m : scratch[t]->generator.GenerateMoves(&board)) {
+				bool leavesTable = board.Square[m.targetSquare] != Piece::None || m.type == Move::Promotion;
+				board.makeMove(m, board);
+				if (!board.isSquareAttacked(board.findKingSquare(colorToMove), them, board)) {
+					legalMoves++;
+					if (leavesTable) {
+						string exitMaterial = Tablebase::materialOf(board);
+						uint8_t exit = (exitMaterial == "KvK") ? Tablebase::Draw : backUp(exits.at(exitMaterial)->probe(board));
+						if (bestExit == NoExit || preference(exit) > preference(bestExit))
+							bestExit = exit;
+					}
+					else {
+						uint64_t child;
+						table.index(board, child);
+						successors.push_back(child);
+					}
+				}
+				board.undoMove(m);
+			}
+
+			if (legalMoves == 0) {
+				bool inCheck = board.isSquareAttacked(board.findKingSquare(colorToMove), them, board);
+				value[i] = inCheck ? Tablebase::fromPlies(0) : Tablebase::Draw;
+				continue;
+			}
+
+			sort(successors.begin(), successors.end());
+			successors.erase(unique(successors.begin(), successors.end()), successors.end());
+			children[i].store(static_cast<uint8_t>(successors.size()), memory_order_relaxed);
+			exitValue[i] = bestExit;
+
+			if (Tablebase::isWin(bestExit)) {
+				pendingWin[i].store(static_cast<uint8_t>(Tablebase::pliesToMate(bestExit)), memory_order_relaxed);
+				atomicMax(highestPending, Tablebase::pliesToMate(bestExit));
+			}
+			else if (successors.empty()) {
+				if (Tablebase::isLoss(bestExit)) {
+					pendingLoss[i].store(static_cast<uint8_t>(Tablebase::pliesToMate(bestExit)), memory_order_relaxed);
+					atomicMax(highestPending, Tablebase::pliesToMate(bestExit));
+				}
+				else {
+					value[i] = Tablebase::Draw;
+				}
+			}
+		}
+	});
+
+	// Pass 2, one ply at a time: settle the positions due at this ply, then un-move from them
+	int longest = 0;
+	for (int ply = 0; ply <= Tablebase::MaxPlies; ++ply) {
+		atomic<uint64_t> settled{ 0 };
+		parallelFor(total, threads, [&](uint64_t begin, uint64_t end, int) {
+			uint64_t count = 0;
+			for (uint64_t i = begin; i < end; ++i) {
+				if (value[i] == Unknown &&
+					(pendingWin[i].load(memory_order_relaxed) == ply || pendingLoss[i].load(memory_order_relaxed) == ply))
+					value[i] = Tablebase::fromPlies(ply);
+				if (value[i] == Tablebase::fromPlies(ply))
+					count++;
+			}
+			settled += count;
+		});
+
+		if (settled == 0 && ply >= highestPending)
+			break;
+		if (settled > 0)
+			longest = ply;
+
+		parallelFor(total, threads, [&](uint64_t begin, uint64_t end, int t) {
+			vector<uint64_t>& predecessors = scratch[t]->successors;
+			vector<int>& targets = scratch[t]->targets;
+			int squares[Tablebase::MaxPieces], before[Tablebase::MaxPieces];
+			int colorToMove;
+
+			for (uint64_t i = begin; i < end; ++i) {
+				if (value[i] != Tablebase::fromPlies(ply))
+					continue;
+				bool lost = Tablebase::isLoss(value[i]);
+
+				table.squaresOf(i, squares, colorToMove);
+				int mover = Piece::GetOpponentColor(colorToMove);
+				uint64_t occupied = 0;
+				for (int j = 0; j < table.pieceCount(); ++j)
+					occupied |= 1ULL << squares[j];
+
+				predecessors.clear();
+				for (int j = 0; j < table.pieceCount(); ++j) {
+					int piece = table.pieceCodes()[j];
+					if (!Piece::IsColor(piece, mover))
+						continue;
+					unmoveTargets(piece, squares[j], occupied, targets);
+					for (int from : targets) {
+						memcpy(before, squares, sizeof(int) * table.pieceCount());
+						before[j] = from;
+						predecessors.push_back(table.indexOf(before, mover));
+					}
+				}
+				sort(predecessors.begin(), predecessors.end());
+				predecessors.erase(unique(predecessors.begin(), predecessors.end()), predecessors.end());
+
+				for (uint64_t p : predecessors) {
+					if (value[p] != Unknown)
+						continue;
+
+					if (lost) {
+						// Moving here wins for the predecessor's side to move
+						atomicMin(pendingWin[p], static_cast<uint8_t>(ply + 1));
+						atomicMax(highestPending, ply + 1);
+					}
+					else if (children[p].fetch_sub(1) == 1) {
+						// Every move inside the table loses; the best exit decides the rest
+						uint8_t exit = exitValue[p];
+						if (exit != NoExit && !Tablebase::isLoss(exit))
+							continue;
+						int plies = ply + 1;
+						if (exit != NoExit)
+							plies = max(plies, Tablebase::pliesToMate(exit));
+						pendingLoss[p].store(static_cast<uint8_t>(plies));
+						atomicMax(highestPending, plies);
+					}
+				}
+			}
+		});
+	}
+
+	uint64_t wins = 0, losses = 0, draws = 0;
+	for (uint8_t& v : value) {
+		if (v == Unknown)
+			v = Tablebase::Draw;
+		if (Tablebase::isWin(v)) wins++;
+		else if (Tablebase::isLoss(v)) losses++;
+		else if (v == Tablebase::Draw) draws++;
+	}
+
+	string path = directory + "/" + Tablebase::fileName(table.material());
+	FILE* out = fopen(path.c_str(), "wb");
+	if (!out)
+		return false;
+
+	Tablebase::FileHeader header = {};
+	memcpy(header.magic, "CWCTBASE", 8);
+	header.version = Tablebase::Version;
+	header.pieceCount = table.pieceCount();
+	strncpy(header.material, table.material().c_str(), sizeof(header.material) - 1);
+	header.positions = table.positions();
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(value.data(), 1, value.size(), out);
+	bool ok = ferror(out) == 0;
+	fclose(out);
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	cout << table.material() << ": " << (wins + losses + draws) << " positions, " << wins << " wins, "
+		<< losses << " losses, " << draws << " draws, longest mate " << longest << " plies, "
+		<< seconds << " s\n";
+	return ok;
+}
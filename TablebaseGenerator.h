@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Tablebase.h"
+#include "moveGenerator.h"
+#include "useFullStuff.h"
+
+using namespace std;
+
+// Builds Tablebase files by retrograde analysis. Every position is first scored once with
+// moveGenerator: checkmates, stalemates, and captures or promotions that leave the table
+// (looked up in the smaller tables, which are generated first when missing). Then the
+// results spread backwards one ply at a time, un-moving pieces from the positions decided
+// at the previous ply. Both passes run on several threads over the index space.
+class TablebaseGenerator {
+public:
+	// Writes directory/<material>.cwtb; existing smaller tables in directory are reused
+	static bool generate(const string& material, const string& directory, int threads);
+
+	// Every material with pieceCount pieces (kings included), e.g. "KQvK" ... for 3
+	static vector<string> allMaterials(int pieceCount);
+};
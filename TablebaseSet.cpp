@@ -0,0 +1,68 @@
+#include "TablebaseSet.h"
+#include <filesystem>
+
+using namespace std;
+
+int TablebaseSet::open(const string& directory) {
+	clear();
+
+	error_code error;
+	for (const auto& entry : filesystem::directory_iterator(directory, error)) {
+		if (entry.path().extension() != ".cwtb")
+			continue;
+		auto table = make_unique<Tablebase>();
+		if (!table->open(entry.path().string()))
+			continue;
+		largest = max(largest, table->pieceCount());
+		tables[table->material()] = move(table);
+	}
+	return count();
+}
+
+void TablebaseSet::clear() {
+	tables.clear();
+	largest = 0;
+}
+
+uint8_t TablebaseSet::probe(const Board& board) const {
+	if (tables.empty() || board.enPassantSquare != -1 || board.getCastlingRightsMask() != 0)
+		return Tablebase::Invalid;
+
+	auto it = tables.find(Tablebase::materialOf(board));
+	if (it == tables.end())
+		return Tablebase::Invalid;
+	return it->second->probe(board);
+}
+
+// How good a move into child is for the mover: quickest mate first, slowest loss last
+static int moverPreference(uint8_t child) {
+	if (Tablebase::isLoss(child)) return 1000 - Tablebase::pliesToMate(child) - 1;
+	if (Tablebase::isWin(child)) return -1000 + Tablebase::pliesToMate(child) + 1;
+	return 0;
+}
+
+bool TablebaseSet::filterRootMoves(Board& board, vector<Move>& moves) const {
+	if (moves.empty() || probe(board) == Tablebase::Invalid)
+		return false;
+
+	// Captures into K v K are draws; a double pawn step is scored as if no en passant followed
+	vector<int> scores;
+	for (Move& m : moves) {
+		Board child = board;
+		child.makeMove(m, child);
+		child.enPassantSquare = -1;
+		uint8_t value = (Tablebase::materialOf(child) == "KvK") ? Tablebase::Draw : probe(child);
+		if (value == Tablebase::Invalid)
+			return false;
+		scores.push_back(moverPreference(value));
+	}
+
+	int best = *max_element(scores.begin(), scores.end());
+	vector<Move> kept;
+	for (size_t i = 0; i < moves.size(); ++i) {
+		if (scores[i] == best)
+			kept.push_back(moves[i]);
+	}
+	moves.swap(kept);
+	return true;
+}
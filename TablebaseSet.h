@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Tablebase.h"
+#include "moveGenerator.h"
+#include "useFullStuff.h"
+#include <map>
+#include <memory>
+
+using namespace std;
+
+// All Tablebase files of one directory, looked up by the material on the board.
+// Tables are read-only once opened, so any number of search threads can probe at once;
+// open() and clear() must not run while a search is probing.
+class TablebaseSet {
+public:
+	// Maps every .cwtb file in directory; returns the number of tables found
+	int open(const string& directory);
+	void clear();
+
+	int count() const { return static_cast<int>(tables.size()); }
+	int maxPieces() const { return largest; }
+
+	// Table value for the board's side to move, Tablebase::Invalid when no table covers it
+	// (missing material, castling rights or an en passant square)
+	uint8_t probe(const Board& board) const;
+
+	// Keeps the legal moves that reach the best table value: the quickest mate, otherwise a
+	// draw, otherwise the slowest loss. False, and moves untouched, if the position isn't covered.
+	bool filterRootMoves(Board& board, vector<Move>& moves) const;
+
+private:
+	map<string, unique_ptr<Tablebase>> tables;
+	int largest = 0;
+};
@@ -0,0 +1,77 @@
+#include "TrainingData.h"
+
+using namespace std;
+
+TrainingWriter::TrainingWriter(const string& path, size_t recordsPerBuffer) : capacity(max<size_t>(1, recordsPerBuffer)) {
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+		return;
+
+	filling.reserve(capacity);
+	flushing.reserve(capacity);
+	writerThread = thread([this]() { writerLoop(); });
+}
+
+TrainingWriter::~TrainingWriter() {
+	close();
+}
+
+void TrainingWriter::write(const vector<PackedBoard>& records) {
+	unique_lock<mutex> guard(lock);
+	if (!file || closing)
+		return;
+
+	filling.insert(filling.end(), records.begin(), records.end());
+	count += records.size();
+	if (filling.size() < capacity)
+		return;
+
+	// Hand the full buffer over once the writer is done with the other one
+	changed.wait(guard, [this]() { return !flushPending; });
+	filling.swap(flushing);
+	flushPending = true;
+	changed.notify_all();
+}
+
+void TrainingWriter::writerLoop() {
+	unique_lock<mutex> guard(lock);
+	for (;;) {
+		changed.wait(guard, [this]() { return flushPending || closing; });
+		if (!flushPending)
+			return;
+
+		// The disk write happens outside the lock, producers keep filling the other buffer
+		guard.unlock();
+		bool ok = flushing.empty() || fwrite(flushing.data(), sizeof(PackedBoard), flushing.size(), file) == flushing.size();
+		guard.lock();
+
+		failed |= !ok;
+		flushing.clear();
+		flushPending = false;
+		changed.notify_all();
+	}
+}
+
+bool TrainingWriter::close() {
+	{
+		unique_lock<mutex> guard(lock);
+		if (!file)
+			return !failed;
+
+		changed.wait(guard, [this]() { return !flushPending; });
+		filling.swap(flushing);
+		flushPending = true;
+		closing = true;
+		changed.notify_all();
+	}
+	writerThread.join();
+
+	failed |= fclose(file) != 0;
+	file = nullptr;
+	return !failed;
+}
+
+uint64_t TrainingWriter::written() const {
+	lock_guard<mutex> guard(lock);
+	return count;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "PackedBoard.h"
+#include "useFullStuff.h"
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+using namespace std;
+
+// Appends labelled PackedBoards (training positions) to a file from any number of threads.
+// Records collect in one buffer while a background thread writes the other, so producers
+// never wait on the disk unless they fill a whole buffer before the previous one is written.
+class TrainingWriter {
+public:
+	explicit TrainingWriter(const string& path, size_t recordsPerBuffer = 1 << 16);
+	~TrainingWriter();
+
+	TrainingWriter(const TrainingWriter&) = delete;
+	TrainingWriter& operator=(const TrainingWriter&) = delete;
+
+	bool isOpen() const { return file != nullptr; }
+
+	// Thread-safe; a game's records stay together in the file
+	void write(const vector<PackedBoard>& records);
+
+	// Writes what is left and closes the file; false if any write failed
+	bool close();
+
+	uint64_t written() const;
+
+private:
+	FILE* file = nullptr;
+	size_t capacity;
+	vector<PackedBoard> filling, flushing;
+	bool flushPending = false;
+	bool closing = false;
+	bool failed = false;
+	uint64_t count = 0;
+
+	mutable mutex lock;
+	condition_variable changed;
+	thread writerThread;
+
+	void writerLoop();
+};
@@ -0,0 +1,65 @@
+#include "TranspositionTable.h"
+
+using namespace std;
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+	resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+	size_t bytes = max<size_t>(megabytes, 1) * 1024 * 1024;
+	size_t count = 1;
+	while (count * 2 * sizeof(Slot) <= bytes)
+		count *= 2; // power of two so the index is a mask
+
+	slots.reset(new Slot[count]);
+	slotCount = count;
+}
+
+void TranspositionTable::clear() {
+	for (size_t i = 0; i < slotCount; ++i) {
+		slots[i].keyXorData.store(0, memory_order_relaxed);
+		slots[i].data.store(0, memory_order_relaxed);
+	}
+}
+
+bool TranspositionTable::probe(uint64_t key, Entry& entry) const {
+	const Slot& slot = slots[key & (slotCount - 1)];
+	uint64_t data = slot.data.load(memory_order_relaxed);
+	uint64_t check = slot.keyXorData.load(memory_order_relaxed);
+
+	if ((check ^ data) != key || data == 0)
+		return false;
+
+	entry.move = static_cast<uint16_t>(data & 0xFFFF);
+	entry.score = static_cast<int16_t>((data >> 16) & 0xFFFF);
+	entry.depth = static_cast<int>((data >> 32) & 0xFF);
+	entry.bound = static_cast<Bound>((data >> 40) & 0x3);
+	return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, Bound bound, uint16_t move) {
+	Slot& slot = slots[key & (slotCount - 1)];
+
+	// Keep the old move when this result has none for the same position
+	Entry old;
+	if (move == 0 && probe(key, old))
+		move = old.move;
+
+	uint64_t data = static_cast<uint64_t>(move)
+		| (static_cast<uint64_t>(static_cast<uint16_t>(score)) << 16)
+		| (static_cast<uint64_t>(max(0, min(depth, 255))) << 32)
+		| (static_cast<uint64_t>(bound) << 40);
+
+	slot.keyXorData.store(key ^ data, memory_order_relaxed);
+	slot.data.store(data, memory_order_relaxed);
+}
+
+uint16_t TranspositionTable::packMove(const Move& move) {
+	int promo = (move.type == Move::Promotion) ? move.promotionPiece : 0;
+	return static_cast<uint16_t>(move.startSquare | (move.targetSquare << 6) | (promo << 12));
+}
+
+bool TranspositionTable::samePackedMove(const Move& move, uint16_t packed) {
+	return packed != 0 && packMove(move) == packed;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "useFullStuff.h"
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+// Shared hash table for the search. Every slot stores (key ^ data, data) so
+// threads can read and write without locks; a torn write just fails the key check.
+class TranspositionTable {
+public:
+	enum Bound : uint8_t {
+		NoBound = 0,
+		Exact = 1,
+		LowerBound = 2,
+		UpperBound = 3
+	};
+
+	struct Entry {
+		int score = 0;
+		int depth = 0;
+		Bound bound = NoBound;
+		uint16_t move = 0;
+	};
+
+	TranspositionTable(size_t megabytes = 16);
+
+	void resize(size_t megabytes);
+	void clear();
+	bool probe(uint64_t key, Entry& entry) const;
+	void store(uint64_t key, int depth, int score, Bound bound, uint16_t move);
+
+	// from (6 bits) | to (6 bits) | promotion piece type (3 bits)
+	static uint16_t packMove(const Move& move);
+	static bool samePackedMove(const Move& move, uint16_t packed);
+
+private:
+	struct Slot {
+		atomic<uint64_t> keyXorData{ 0 };
+		atomic<uint64_t> data{ 0 };
+	};
+
+	unique_ptr<Slot[]> slots;
+	size_t slotCount = 0;
+};
@@ -0,0 +1,214 @@
+// epdSuite.cpp
+// Runs an EPD test suite (WAC, STS, ...) through the search and reports how many
+// positions were solved. Positions are shared out over a pool of threads; every
+// worker has its own Board and its own Search (and so its own transposition table).
+//
+// usage: epdSuite <file.epd> [--movetime ms] [--nodes n] [--depth d] [--threads n] [--hash mb]
+#include "Search.h"
+#include "FenReader.h"
+#include "notation.h"
+#include <thread>
+#include <mutex>
+#include <cstring>
+
+using namespace std;
+
+struct EpdPosition {
+	string fen;
+	string id;
+	vector<string> bestMoves;   // bm, in SAN
+	vector<string> avoidMoves;  // am, in SAN
+};
+
+struct EpdResult {
+	bool solved = false;
+	string played;
+	int64_t solvedAtMs = -1;    // when the solving move became (and stayed) the best move
+	uint64_t nodes = 0;
+	int64_t timeMs = 0;
+};
+
+static vector<string> splitWords(const string& text) {
+	vector<string> words;
+	size_t i = 0;
+	while (i < text.size()) {
+		while (i < text.size() && text[i] == ' ') ++i;
+		size_t start = i;
+		while (i < text.size() && text[i] != ' ') ++i;
+		if (i > start)
+			words.push_back(text.substr(start, i - start));
+	}
+	return words;
+}
+
+// "<4 FEN fields> opcode operands; opcode operands; ..."
+static bool parseEpd(const char* line, size_t length, EpdPosition& pos) {
+	string text(line, length);
+	size_t p = 0;
+	for (int field = 0; field < 4; ++field) {
+		p = text.find_first_not_of(' ', p);
+		p = text.find(' ', p);
+		if (p == string::npos)
+			return false;
+	}
+	pos.fen = text.substr(0, p);
+
+	size_t start = p;
+	while (start < text.size()) {
+		size_t end = text.find(';', start);
+		if (end == string::npos)
+			end = text.size();
+
+		vector<string> words = splitWords(text.substr(start, end - start));
+		if (!words.empty()) {
+			const string& opcode = words[0];
+			if (opcode == "bm")
+				pos.bestMoves.assign(words.begin() + 1, words.end());
+			else if (opcode == "am")
+				pos.avoidMoves.assign(words.begin() + 1, words.end());
+			else if (opcode == "id" && words.size() > 1) {
+				string id = text.substr(text.find(words[1], start), end - text.find(words[1], start));
+				id.erase(remove(id.begin(), id.end(), '"'), id.end());
+				pos.id = id;
+			}
+		}
+		start = end + 1;
+	}
+
+	return !pos.bestMoves.empty() || !pos.avoidMoves.empty();
+}
+
+static bool isSolution(const Move& move, const EpdPosition& pos, const Board& board, const vector<Move>& legal) {
+	Move target(0, 0);
+	for (const string& san : pos.avoidMoves) {
+		if (notation::sanToMove(san, board, legal, target) && TranspositionTable::packMove(target) == TranspositionTable::packMove(move))
+			return false;
+	}
+	if (pos.bestMoves.empty())
+		return true;
+	for (const string& san : pos.bestMoves) {
+		if (notation::sanToMove(san, board, legal, target) && TranspositionTable::packMove(target) == TranspositionTable::packMove(move))
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cout << "usage: epdSuite <file.epd> [--movetime ms] [--nodes n] [--depth d] [--threads n] [--hash mb]\n";
+		return 1;
+	}
+
+	SearchLimits limits;
+	int threadCount = max(1u, thread::hardware_concurrency());
+	int hashMb = 16;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--movetime")) limits.movetime = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--nodes")) limits.nodes = strtoull(argv[i + 1], nullptr, 10);
+		else if (!strcmp(argv[i], "--depth")) limits.depth = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--threads")) threadCount = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--hash")) hashMb = atoi(argv[i + 1]);
+	}
+	if (limits.movetime == 0 && limits.nodes == 0 && limits.depth == 0)
+		limits.movetime = 1000;
+
+	PrecomputedMoveData::Init();
+
+	FenReader reader(argv[1]);
+	if (!reader.isOpen()) {
+		cout << "Cannot open " << argv[1] << "\n";
+		return 1;
+	}
+
+	vector<EpdPosition> positions;
+	const char* line;
+	size_t length;
+	while (reader.nextLine(line, length)) {
+		EpdPosition pos;
+		if (parseEpd(line, length, pos)) {
+			if (pos.id.empty())
+				pos.id = "#" + to_string(positions.size() + 1);
+			positions.push_back(move(pos));
+		}
+	}
+
+	vector<EpdResult> results(positions.size());
+	atomic<size_t> nextIndex{ 0 };
+	mutex outputMutex;
+	auto started = chrono::steady_clock::now();
+
+	auto worker = [&]() {
+		Search search;
+		search.setHashSize(hashMb);
+		moveGenerator generator;
+		Board board;
+
+		for (size_t i = nextIndex++; i < positions.size(); i = nextIndex++) {
+			const EpdPosition& pos = positions[i];
+			EpdResult& result = results[i];
+			if (!board.setFen(pos.fen))
+				continue;
+			board.recordPosition();
+			vector<Move> legal = generator.GenerateLegalMoves(&board);
+
+			search.newGame();
+			auto t0 = chrono::steady_clock::now();
+			Move best = search.think(board, limits, [&](const SearchInfo& info) {
+				if (info.pv.empty())
+					return;
+				if (isSolution(info.pv[0], pos, board, legal)) {
+					if (result.solvedAtMs < 0)
+						result.solvedAtMs = info.timeMs;
+				}
+				else {
+					result.solvedAtMs = -1;
+				}
+			});
+
+			result.timeMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - t0).count();
+			result.nodes = search.nodes();
+			result.played = notation::moveToUCI(best);
+			result.solved = isSolution(best, pos, board, legal);
+			if (!result.solved)
+				result.solvedAtMs = -1;
+			else if (result.solvedAtMs < 0)
+				result.solvedAtMs = result.timeMs;
+
+			lock_guard<mutex> lock(outputMutex);
+			cout << (result.solved ? "solved  " : "FAILED  ") << pos.id << "  played " << result.played
+				<< "  bm";
+			for (const string& bm : pos.bestMoves) cout << " " << bm;
+			if (!pos.avoidMoves.empty()) {
+				cout << "  am";
+				for (const string& am : pos.avoidMoves) cout << " " << am;
+			}
+			cout << "  time " << result.solvedAtMs << "/" << result.timeMs << " ms  nodes " << result.nodes << "\n";
+		}
+	};
+
+	vector<thread> pool;
+	for (int t = 0; t < threadCount; ++t)
+		pool.emplace_back(worker);
+	for (auto& t : pool)
+		t.join();
+
+	int64_t wallMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+	int solved = 0;
+	int64_t solveTime = 0, searchTime = 0;
+	uint64_t totalNodes = 0;
+	for (const EpdResult& r : results) {
+		if (r.solved) {
+			solved++;
+			solveTime += r.solvedAtMs;
+		}
+		searchTime += r.timeMs;
+		totalNodes += r.nodes;
+	}
+
+	cout << "\nSolved " << solved << " / " << positions.size() << "\n";
+	cout << "Average time to solution: " << (solved ? solveTime / solved : 0) << " ms\n";
+	cout << "Nodes: " << totalNodes << "  nps per thread: " << (searchTime > 0 ? totalNodes * 1000 / searchTime : 0)
+		<< "  total nps: " << (wallMs > 0 ? totalNodes * 1000 / wallMs : 0) << "\n";
+	cout << "Wall time: " << wallMs << " ms on " << threadCount << " threads\n";
+	return 0;
+}
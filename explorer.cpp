@@ -0,0 +1,92 @@
+// explorer.cpp
+// Builds and queries the opening explorer index (PositionIndex) of a GameStore archive.
+//
+// usage: explorer build <games.bin> <explorer.idx> [--threads n] [--maxply n] [--memory mb]
+//        explorer query <explorer.idx> ["<fen>"]
+#include "PositionIndex.h"
+#include "notation.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+static void printStats(const PositionIndex& index, Board& board) {
+	moveGenerator generator;
+	vector<Move> legal = generator.GenerateLegalMoves(&board);
+
+	auto started = chrono::steady_clock::now();
+	auto range = index.lookup(board.zobristKey);
+	double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - started).count();
+
+	vector<PositionIndex::MoveStats> stats(range.first, range.second);
+	sort(stats.begin(), stats.end(), [](const PositionIndex::MoveStats& a, const PositionIndex::MoveStats& b) {
+		return a.games > b.games;
+	});
+
+	cout << board.getFen() << "  (" << stats.size() << " moves, lookup " << micros << " us)\n";
+	for (const auto& s : stats) {
+		string san = "?";
+		for (const Move& m : legal) {
+			if (PositionIndex::packMove(m) == s.move)
+				san = notation::sanWithoutCheck(m, board, legal);
+		}
+		cout << "  " << san << "\t" << s.games << " games\t+" << s.whiteWins << " =" << s.draws << " -" << s.blackWins << "\n";
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		cout << "usage: explorer build <games.bin> <explorer.idx> [--threads n] [--maxply n] [--memory mb]\n"
+			<< "       explorer query <explorer.idx> [\"<fen>\"]\n";
+		return 1;
+	}
+
+	PrecomputedMoveData::Init();
+	string command = argv[1];
+
+	if (command == "build" && argc >= 4) {
+		int threads = max(1u, thread::hardware_concurrency());
+		int maxPly = 0;
+		size_t memoryMb = 1024;
+		for (int i = 4; i + 1 < argc; i += 2) {
+			if (!strcmp(argv[i], "--threads")) threads = max(1, atoi(argv[i + 1]));
+			else if (!strcmp(argv[i], "--maxply")) maxPly = atoi(argv[i + 1]);
+			else if (!strcmp(argv[i], "--memory")) memoryMb = max(1, atoi(argv[i + 1]));
+		}
+
+		GameStore store(argv[2]);
+		if (!store.isOpen()) {
+			cout << "Cannot open " << argv[2] << "\n";
+			return 1;
+		}
+
+		auto started = chrono::steady_clock::now();
+		bool ok = PositionIndex::build(store, argv[3], threads, maxPly, memoryMb);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+		PositionIndex index(argv[3]);
+		cout << (ok ? "Indexed " : "FAILED after ") << store.gameCount() << " games into "
+			<< index.recordCount() << " position/move records in " << seconds << " s\n";
+		return ok ? 0 : 1;
+	}
+
+	if (command == "query") {
+		PositionIndex index(argv[2]);
+		if (!index.isOpen()) {
+			cout << "Cannot open " << argv[2] << "\n";
+			return 1;
+		}
+
+		Board board;
+		if (argc >= 4 && !board.setFen(argv[3])) {
+			cout << "Bad FEN\n";
+			return 1;
+		}
+		printStats(index, board);
+		return 0;
+	}
+
+	cout << "Unknown command " << command << "\n";
+	return 1;
+}
@@ -1,5 +1,7 @@
 ﻿#include "BoardUI.h"
 #include "notation.h"
+#include "PositionIndex.h"
+#include "PolyglotBook.h"
 
 using namespace std;
 
@@ -8,6 +10,8 @@ class Agent {
 private:
 	moveGenerator generator;
 	vector<Move> legalMoves;
+	PolyglotBook book{ "book.bin" }; // optional Polyglot opening book
+	mt19937 rng{ random_device{}() };
 
 public:
 
@@ -34,7 +38,19 @@ public:
 
 	void playRandomMove(Board& board) {
 		//cout << "called function";
-		legalMoves = generator.GenerateLegalMoves(&board);
+
+		// The book needs the whole legal list; without one, testing the drawn move is enough
+		if (book.isOpen()) {
+			legalMoves = generator.GenerateLegalMoves(&board);
+
+			Move bookMove(0, 0);
+			if (book.probe(board, legalMoves, bookMove, &rng)) {
+				board.makeMove(bookMove, board);
+				board.recordPosition();
+				gameMoves.push_back(bookMove);
+				return;
+			}
+		}
 		
 		// Print all legal moves
 		//for (const Move& move : legalMoves) {
@@ -42,12 +58,13 @@ public:
 		//	std::cout << "-------------------\n";
 		//}
 
-		int r = rand() % legalMoves.size();
-		Move chosen = legalMoves[r];
+		Move chosen(0, 0);
+		if (!generator.GenerateRandomLegalMove(&board, rng, chosen))
+			return;
 		//cout << "Bot move: " << chosen.startSquare << " -> " << chosen.targetSquare << " to : " << chosen.promotionPiece << "\n";
 
 		board.makeMove(chosen,board);
-		board.recordPosition(board);	
+		board.recordPosition();	
 		gameMoves.push_back(chosen);
 	}
 
@@ -63,10 +80,12 @@ private:
 	BoardUI boardUi;
 	moveGenerator generator;
 	int selectedSquare = -1;
-	vector<Move> legalMoves;
+	vector<Move> legalMoves;      // of the selected piece only
+	uint64_t legalTargets = 0;    // their target squares, for the highlight
 	bool gameOver = false;
 	string resultMessage = "";
 	Agent agent;
+	PositionIndex explorer{ "explorer.idx" }; // built with the explorer tool, optional
 
 
 
@@ -88,7 +107,31 @@ public:
 		return gameOver;
 	}
 
+	// Prints how often each move was played from the current position in the indexed games
+	void showExplorer() {
+		if (!explorer.isOpen()) {
+			cout << "No explorer.idx found\n";
+			return;
+		}
+
+		vector<Move> moves = generator.GenerateLegalMoves(&board);
+		auto range = explorer.lookup(board.zobristKey);
+		cout << "Explorer: " << (range.second - range.first) << " moves from this position\n";
+		for (auto s = range.first; s != range.second; ++s) {
+			for (const Move& m : moves) {
+				if (PositionIndex::packMove(m) == s->move)
+					cout << "  " << notation::sanWithoutCheck(m, board, moves) << "\t" << s->games
+						<< " games\t+" << s->whiteWins << " =" << s->draws << " -" << s->blackWins << "\n";
+			}
+		}
+	}
+
 	void handleEvent(SDL_Event& e, SDL_Renderer* renderer) {
+		if (e.type == SDL_EVENT_KEY_DOWN && e.key.key == SDLK_E) {
+			showExplorer();
+			return;
+		}
+
 		if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN && e.button.button == SDL_BUTTON_LEFT) {
 			int mouseX = e.button.x;
 			int mouseY = e.button.y;
@@ -99,17 +142,17 @@ public:
 				// Select a piece if it's your color
 				if (Piece::IsColor(clickedPiece, board.colorToMove)) {
 					selectedSquare = clickedSquare;
-					legalMoves = generator.GenerateLegalMoves(&board);
+					legalMoves = generator.GenerateLegalMovesFrom(&board, selectedSquare);
+					legalTargets = moveGenerator::TargetMask(legalMoves);
 					//cout << "Selected square: " << selectedSquare << "\nLegal moves:\n";
 					for (const auto& m : legalMoves)
-						if (m.startSquare == selectedSquare)
-							cout << m.startSquare << " -> " << m.targetSquare << endl;
+						cout << m.startSquare << " -> " << m.targetSquare << endl;
 				}
 			}
 			else {
 				bool moved = false;
 				for (Move& m : legalMoves) {
-					if (m.startSquare == selectedSquare && m.targetSquare == clickedSquare) {
+					if (m.targetSquare == clickedSquare) {
 						int movingPiece = board.Square[m.startSquare];
 
 						// Handle promotion
@@ -130,10 +173,11 @@ public:
 				// Reset selection
 				selectedSquare = -1;
 				legalMoves.clear();
+				legalTargets = 0;
 
 				if (moved) {
 					isGameOver(renderer, board);  // Check for mate/stalemate
-					board.recordPosition(board);
+					board.recordPosition();
 					
 					//board.printBoard(board);     // Print new board
 				}
@@ -145,7 +189,6 @@ public:
 	void isGameOver(SDL_Renderer* renderer, Board& board) {
 		// Generate legal moves for the current position
 		vector<Move> nextMoves = generator.GenerateLegalMoves(&board);
-		legalMoves = nextMoves; // Update legal moves globally if needed
 
 		int kingSq = board.findKingSquare(board.colorToMove);
 		bool inCheck = board.isSquareAttacked(kingSq, Piece::oppositeColor(board.colorToMove), board);
@@ -192,7 +235,7 @@ public:
 		}
 
 		//// Threefold repetition
-		if (board.isThreefoldRepetition(board)) {
+		if (board.isThreefoldRepetition()) {
 			gameOver = true;
 			cout << "Draw by threefold repetition!\n";
 			string pgn = notation::toPGN(gameMoves,generator);
@@ -223,7 +266,7 @@ public:
 		boardUi.draw(renderer, selectedSquare, legalMoves);
 		boardUi.selectedSquareHighLight(renderer, selectedSquare);
 		boardUi.renderPieces(renderer);
-		boardUi.highLightLegalMoves(renderer, selectedSquare, legalMoves);
+		boardUi.highLightLegalMoves(renderer, legalTargets);
 
 		SDL_RenderPresent(renderer);
 	}
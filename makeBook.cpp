@@ -0,0 +1,113 @@
+// makeBook.cpp
+// Builds a Polyglot opening book from a PGN collection or a GameStore archive.
+// Games are replayed on every core and counted with BookBuilder; collections larger
+// than --memory are spilled to run files next to the output and merged at the end.
+//
+// usage: makeBook <games.pgn|games.bin> <book.bin> [--threads n] [--maxply n] [--mingames n]
+//                 [--minscore percent] [--memory mb]
+#include "BookBuilder.h"
+#include "PgnReader.h"
+#include "GameStore.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		cout << "usage: makeBook <games.pgn|games.bin> <book.bin> [--threads n] [--maxply n] [--mingames n] [--minscore percent] [--memory mb]\n";
+		return 1;
+	}
+
+	int threads = max(1u, thread::hardware_concurrency());
+	size_t maxPly = 30;
+	BookBuilder::Options options;
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--threads")) threads = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--maxply")) maxPly = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--mingames")) options.minGames = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--minscore")) options.minScore = atoi(argv[i + 1]);
+		else if (!strcmp(argv[i], "--memory")) options.memoryMb = max(1, atoi(argv[i + 1]));
+	}
+
+	// A book with wrong keys would only ever be found by this engine
+	if (!PolyglotBook::checkKeys()) {
+		cout << "PolyglotBook::key does not match the Polyglot reference keys, no book written\n";
+		return 1;
+	}
+
+	PrecomputedMoveData::Init();
+	BookBuilder builder(argv[2], options);
+	size_t games = 0;
+	auto started = chrono::steady_clock::now();
+
+	GameStore store(argv[1]);
+	if (store.isOpen()) {
+		atomic<size_t> nextGame{ 0 };
+		auto worker = [&]() {
+			Board board;
+			moveGenerator generator;
+			for (size_t g = nextGame++; g < store.gameCount(); g = nextGame++) {
+				GameStore::GameView view = store.game(g);
+				if (!GameStore::startPosition(view, board))
+					continue;
+
+				GameStore::Result result = static_cast<GameStore::Result>(view.header->result);
+				size_t plies = min<size_t>(view.header->plyCount, maxPly);
+				for (size_t ply = 0; ply < plies; ++ply) {
+					Move m(0, 0);
+					if (!GameStore::decodeMove(board, view.moves[ply], generator, m))
+						break;
+					builder.add(board, m, result);
+					board.makeMove(m, board);
+				}
+			}
+		};
+
+		vector<thread> pool;
+		for (int i = 0; i < threads; ++i)
+			pool.emplace_back(worker);
+		for (auto& t : pool)
+			t.join();
+		games = store.gameCount();
+	}
+	else {
+		PgnReader reader(argv[1]);
+		if (!reader.isOpen()) {
+			cout << "Cannot open " << argv[1] << "\n";
+			return 1;
+		}
+
+		vector<Board> boards(threads);
+		games = reader.read(threads, [&](const PgnGame& game, int threadIndex) {
+			if (!game.valid)
+				return;
+
+			Board& board = boards[threadIndex];
+			if (game.fen.empty())
+				board.setFen(Board::StartFen);
+			else
+				board.setFen(game.fen.data(), game.fen.size());
+
+			GameStore::Result result = GameStore::resultFromString(game.result);
+			size_t plies = min(game.moves.size(), maxPly);
+			for (size_t ply = 0; ply < plies; ++ply) {
+				Move m = game.moves[ply];
+				builder.add(board, m, result);
+				board.makeMove(m, board);
+			}
+		});
+	}
+
+	if (!builder.finish()) {
+		cout << "Cannot write " << argv[2] << "\n";
+		return 1;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	cout << "Games: " << games << ", positions: " << builder.positionsAdded() << "\n";
+	cout << "Book entries: " << builder.entriesWritten() << " written to " << argv[2] << "\n";
+	cout << "Time: " << seconds << " s on " << threads << " threads\n";
+	return 0;
+}
@@ -2,124 +2,307 @@
 
 
 using namespace std;
-vector<Move> moveGenerator::GenerateMoves(Board* board) {
+
+static void AddPromotions(int startSquare, int targetSquare, vector<Move>& moves) {
+	moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Queen));
+	moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Rook));
+	moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Bishop));
+	moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Knight));
+}
+
+vector<Move> moveGenerator::GenerateMoves(Board* board, GenType type) {
+    FillPseudoLegalMoves(board, type);
+    return moves;
+}
+
+void moveGenerator::FillPseudoLegalMoves(Board* board, GenType type) {
     moves.clear();
 
+    bool white = board->colorToMove == Piece::White;
+    switch (type) {
+    case All:
+        white ? GenerateAllPieces<Piece::White, All>(board, moves) : GenerateAllPieces<Piece::Black, All>(board, moves);
+        break;
+    case Captures:
+        white ? GenerateAllPieces<Piece::White, Captures>(board, moves) : GenerateAllPieces<Piece::Black, Captures>(board, moves);
+        break;
+    case Quiets:
+        white ? GenerateAllPieces<Piece::White, Quiets>(board, moves) : GenerateAllPieces<Piece::Black, Quiets>(board, moves);
+        break;
+    case Evasions:
+        white ? GenerateEvasions<Piece::White>(board, moves) : GenerateEvasions<Piece::Black>(board, moves);
+        break;
+    }
+}
+
+void moveGenerator::GeneratePieceMoves(int startSquare, int piece, Board* board, vector<Move>& moves) {
+    if (Piece::IsColor(piece, Piece::White))
+        GeneratePieceMoves<Piece::White, All>(startSquare, piece, board, moves);
+    else
+        GeneratePieceMoves<Piece::Black, All>(startSquare, piece, board, moves);
+}
+
+template<int Us, moveGenerator::GenType Type>
+void moveGenerator::GenerateAllPieces(Board* board, vector<Move>& moves) {
     for (int startSquare = 0; startSquare < 64; ++startSquare) {
         int piece = board->Square[startSquare];
-
-        if (!Piece().IsColor(piece, board->colorToMove))
+        if (piece == Piece::None || !Piece::IsColor(piece, Us))
             continue;
 
-        if (Piece().IsSlidingPiece(piece)) {
-            GenerateSlidingMoves(startSquare, piece, board, moves);
-        }
-        else if (Piece().IsKnight(piece)) {
-            GenerateKnightMoves(startSquare, piece, board, moves);
-        }
-        else if (Piece().IsPawn(piece)) {
-            GeneratePawnMoves(startSquare, piece, board, moves);
-        }
-        else if (Piece().IsKing(piece)) {
-            GenerateKingMoves(startSquare, piece, board, moves);
-        }
+        GeneratePieceMoves<Us, Type>(startSquare, piece, board, moves);
+    }
+}
+
+template<int Us, moveGenerator::GenType Type>
+void moveGenerator::GeneratePieceMoves(int startSquare, int piece, Board* board, vector<Move>& moves) {
+    switch (Piece::Type(piece)) {
+    case Piece::Pawn:   GeneratePawnMoves<Us, Type>(startSquare, board, moves); break;
+    case Piece::Knight: GenerateKnightMoves<Us, Type>(startSquare, board, moves); break;
+    case Piece::Bishop:
+    case Piece::Rook:
+    case Piece::Queen:  GenerateSlidingMoves<Us, Type>(startSquare, Piece::Type(piece), board, moves); break;
+    case Piece::King:   GenerateKingMoves<Us, Type>(startSquare, board, moves); break;
     }
-    return moves;
 }
 
 vector<Move> moveGenerator::GenerateLegalMoves(Board* board) {
+    int kingSq = board->findKingSquare(board->colorToMove);
+    if (kingSq != -1 && board->isSquareAttacked(kingSq, Piece::GetOpponentColor(board->colorToMove), *board))
+        return GenerateEvasions(board);
+
     vector<Move> allMoves = GenerateMoves(board);
     vector<Move> legal;
 
+    // Decided from pins and attacks on the board itself: no copy of the Board per move
     for (auto& move : allMoves) {
-        Board copy = *board;
-        copy.makeMove(move, *board);
-
-        int kingSq = copy.findKingSquare(board->colorToMove);
-        if (!copy.isSquareAttacked(kingSq, Piece::GetOpponentColor(board->colorToMove), copy)) {
+        if (board->isLegal(move))
             legal.push_back(move);
+    }
+
+    return legal;
+}
+
+vector<Move> moveGenerator::GenerateEvasions(Board* board) {
+    vector<Move> evasions;
+    if (board->colorToMove == Piece::White)
+        GenerateEvasions<Piece::White>(board, evasions);
+    else
+        GenerateEvasions<Piece::Black>(board, evasions);
+    return evasions;
+}
+
+template<int Us>
+void moveGenerator::GenerateEvasions(Board* board, vector<Move>& evasions) {
+    constexpr int Them = Us == Piece::White ? Piece::Black : Piece::White;
+    int kingSq = board->findKingSquare(Us);
+    if (kingSq == -1)
+        return;
+
+    // King steps, tested with the king lifted so it cannot hide behind itself on the checking line
+    int king = board->Square[kingSq];
+    board->Square[kingSq] = Piece::None;
+    for (int targetSquare : PrecomputedMoveData::kingMoves[kingSq]) {
+        int targetPiece = board->Square[targetSquare];
+        if (targetPiece != Piece::None && Piece::IsColor(targetPiece, Us))
+            continue;
+        if (!board->isSquareAttacked(targetSquare, Them, *board))
+            evasions.push_back({ kingSq, targetSquare });
+    }
+    board->Square[kingSq] = king;
+
+    int checker;
+    if (board->findCheckers(kingSq, Them, checker) != 1)
+        return;
+
+    // Capture the checker, or block between it and the king when it slides
+    GenerateMovesOnto<Us>(checker, board, evasions);
+    int checkerType = Piece::Type(board->Square[checker]);
+    if (checkerType != Piece::Pawn && checkerType != Piece::Knight) {
+        int rankStep = (checker / 8 > kingSq / 8) - (checker / 8 < kingSq / 8);
+        int fileStep = (checker % 8 > kingSq % 8) - (checker % 8 < kingSq % 8);
+        for (int sq = kingSq + rankStep * 8 + fileStep; sq != checker; sq += rankStep * 8 + fileStep)
+            GenerateMovesOnto<Us>(sq, board, evasions);
+    }
+
+    // En passant takes a checking pawn that has just made a double push. The capture can
+    // still expose the king along the rank, so it is played out.
+    constexpr int Pawn = Piece::Pawn | Us;
+    int ep = board->enPassantSquare;
+    if (ep != -1 && checker == ep - (Us == Piece::White ? 8 : -8)) {
+        for (int side : { -1, 1 }) {
+            int startSquare = checker + side;
+            if (startSquare / 8 != checker / 8 || board->Square[startSquare] != Pawn)
+                continue;
+            Move m(startSquare, ep, Move::EnPassant);
+            if (IsLegalMove(board, m))
+                evasions.push_back(m);
+        }
+    }
+}
+
+template<int Us>
+void moveGenerator::GenerateMovesOnto(int targetSquare, Board* board, vector<Move>& moves) {
+    constexpr int Direction = Us == Piece::White ? 8 : -8;
+    constexpr int DoublePushRank = Us == Piece::White ? 3 : 4;
+    constexpr int PromotionRank = Us == Piece::White ? 7 : 0;
+    constexpr int Pawn = Piece::Pawn | Us, Knight = Piece::Knight | Us;
+    constexpr int Bishop = Piece::Bishop | Us, Rook = Piece::Rook | Us, Queen = Piece::Queen | Us;
+    int targetPiece = board->Square[targetSquare];
+    bool promotes = targetSquare / 8 == PromotionRank;
+
+    auto add = [&](int startSquare) {
+        if (board->pinDirection(startSquare) != -1)
+            return;
+        if (promotes && board->Square[startSquare] == Pawn)
+            AddPromotions(startSquare, targetSquare, moves);
+        else
+            moves.push_back({ startSquare, targetSquare });
+    };
+
+    // Pawns capture onto an occupied square and push onto an empty one
+    int behind = targetSquare - Direction;
+    if (behind >= 0 && behind < 64) {
+        if (targetPiece != Piece::None) {
+            if (targetSquare % 8 > 0 && board->Square[behind - 1] == Pawn) add(behind - 1);
+            if (targetSquare % 8 < 7 && board->Square[behind + 1] == Pawn) add(behind + 1);
+        }
+        else if (board->Square[behind] == Pawn) {
+            add(behind);
+        }
+        else if (board->Square[behind] == Piece::None && targetSquare / 8 == DoublePushRank
+            && board->Square[behind - Direction] == Pawn) {
+            add(behind - Direction);
+        }
+    }
+
+    for (int startSquare : PrecomputedMoveData::knightMoves[targetSquare]) {
+        if (board->Square[startSquare] == Knight)
+            add(startSquare);
+    }
+
+    // Sliders: the first piece seen from the target along each line
+    for (int dir = 0; dir < 8; ++dir) {
+        for (int n = 1; n <= PrecomputedMoveData::NumSquaresToEdge[targetSquare][dir]; ++n) {
+            int startSquare = targetSquare + PrecomputedMoveData::DirectionOffsets[dir] * n;
+            int piece = board->Square[startSquare];
+            if (piece == Piece::None)
+                continue;
+            if (piece == Queen || piece == (dir < 4 ? Rook : Bishop))
+                add(startSquare);
+            break;
         }
     }
+}
 
+bool moveGenerator::IsLegalMove(Board* board, Move& move) {
+    int color = board->colorToMove;
+    board->makeMove(move, *board);
+    int kingSq = board->findKingSquare(color);
+    bool legal = !board->isSquareAttacked(kingSq, Piece::GetOpponentColor(color), *board);
+    board->undoMove(move);
     return legal;
 }
 
-void moveGenerator::GeneratePawnMoves(int startSquare, int piece, Board* board, vector<Move>& moves) {
-	int direction = Piece::IsWhite(piece) ? 8 : -8;
-	int startRank = Piece::IsWhite(piece) ? 1 : 6;
-	int promotionRank = Piece::IsWhite(piece) ? 7 : 0;
+bool moveGenerator::GenerateRandomLegalMove(Board* board, mt19937& rng, Move& move) {
+    FillPseudoLegalMoves(board);
+
+    // Drawn without replacement: an illegal move is swapped out of the range and we draw again
+    for (size_t left = moves.size(); left > 0; --left) {
+        size_t i = uniform_int_distribution<size_t>(0, left - 1)(rng);
+        if (IsLegalMove(board, moves[i])) {
+            move = moves[i];
+            return true;
+        }
+        swap(moves[i], moves[left - 1]);
+    }
+    return false;
+}
+
+vector<Move> moveGenerator::GenerateLegalMovesFrom(Board* board, int square) {
+    vector<Move> pieceMoves;
+    int piece = board->Square[square];
+    if (piece == Piece::None || !Piece::IsColor(piece, board->colorToMove))
+        return pieceMoves;
+
+    GeneratePieceMoves(square, piece, board, pieceMoves);
+    pieceMoves.erase(remove_if(pieceMoves.begin(), pieceMoves.end(), [&](Move& m) {
+        return !IsLegalMove(board, m);
+    }), pieceMoves.end());
+    return pieceMoves;
+}
+
+uint64_t moveGenerator::TargetMask(const vector<Move>& moves) {
+    uint64_t mask = 0;
+    for (const Move& m : moves)
+        mask |= 1ULL << m.targetSquare;
+    return mask;
+}
+
+template<int Us, moveGenerator::GenType Type>
+void moveGenerator::GeneratePawnMoves(int startSquare, Board* board, vector<Move>& moves) {
+	constexpr int Them = Us == Piece::White ? Piece::Black : Piece::White;
+	constexpr int Direction = Us == Piece::White ? 8 : -8;
+	constexpr int StartRank = Us == Piece::White ? 1 : 6;
+	constexpr int PromotionRank = Us == Piece::White ? 7 : 0;
 
-	int forwardSquare = startSquare + direction;
+	int forwardSquare = startSquare + Direction;
 
-	// ?? Forward Move
+	// Forward move
 	if (forwardSquare >= 0 && forwardSquare < 64 && board->Square[forwardSquare] == Piece::None) {
-		int rank = forwardSquare / 8;
-		if (rank == promotionRank) {
-
-			cout << "simple promotion \n";
-			// ?? Promotion options
-			moves.push_back(Move(startSquare, forwardSquare, Move::Promotion, Piece::Queen));
-			moves.push_back(Move(startSquare, forwardSquare, Move::Promotion, Piece::Rook));
-			moves.push_back(Move(startSquare, forwardSquare, Move::Promotion, Piece::Bishop));
-			moves.push_back(Move(startSquare, forwardSquare, Move::Promotion, Piece::Knight));
+		if (forwardSquare / 8 == PromotionRank) {
+			if (Type != Quiets)
+				AddPromotions(startSquare, forwardSquare, moves);
 		}
-		else {
+		else if (Type != Captures) {
 			moves.push_back({ startSquare, forwardSquare });
-		}
 
-		// ?? Double push
-		int doublePush = startSquare + 2 * direction;
-		if ((startSquare / 8) == startRank && board->Square[doublePush] == Piece::None) {
-			moves.push_back({ startSquare, doublePush });
+			// Double push
+			int doublePush = startSquare + 2 * Direction;
+			if ((startSquare / 8) == StartRank && board->Square[doublePush] == Piece::None) {
+				moves.push_back({ startSquare, doublePush });
+			}
 		}
 	}
 
-	// ?? En Passant
+	if (Type == Quiets)
+		return;
+
+	// En passant
 	int canEnPassant = board->enPassantSquare;
 	if (canEnPassant != -1) {
-		int leftCap = startSquare + direction - 1;
-		int rightCap = startSquare + direction + 1;
-		if (leftCap == canEnPassant && (startSquare % 8) != 0)
+		if (startSquare + Direction - 1 == canEnPassant && (startSquare % 8) != 0)
 			moves.push_back({ startSquare, canEnPassant, Move::EnPassant });
-		if (rightCap == canEnPassant && (startSquare % 8) != 7)
+		if (startSquare + Direction + 1 == canEnPassant && (startSquare % 8) != 7)
 			moves.push_back({ startSquare, canEnPassant, Move::EnPassant });
 	}
 
-	// ?? Captures
-	int captures[] = { direction - 1, direction + 1 };
-	for (int capOffset : captures) {
+	// Captures, promoting on the last rank
+	for (int capOffset : { Direction - 1, Direction + 1 }) {
 		int targetSquare = startSquare + capOffset;
-		if (targetSquare < 0 || targetSquare >= 64)
-			continue;
-
-		int startFile = startSquare % 8;
-		int targetFile = targetSquare % 8;
-		if (abs(startFile - targetFile) != 1)
+		if (targetSquare < 0 || targetSquare >= 64 || abs(startSquare % 8 - targetSquare % 8) != 1)
 			continue;
 
 		int targetPiece = board->Square[targetSquare];
-		if (targetPiece != Piece::None &&
-			Piece::IsColor(targetPiece, Piece::GetOpponentColor(board->colorToMove))) {
-
-			int rank = targetSquare / 8;
-			if (rank == promotionRank) {
-				cout << "not simmple promotion" << endl;
-				// ?? Promotion captures
-				moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Queen));
-				moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Rook));
-				moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Bishop));
-				moves.push_back(Move(startSquare, targetSquare, Move::Promotion, Piece::Knight));
-			}
-			else {
+		if (targetPiece != Piece::None && Piece::IsColor(targetPiece, Them)) {
+			if (targetSquare / 8 == PromotionRank)
+				AddPromotions(startSquare, targetSquare, moves);
+			else
 				moves.push_back({ startSquare, targetSquare });
-			}
 		}
 	}
 }
 
+// A step onto an empty square is quiet, onto an enemy piece a capture
+template<int Us, moveGenerator::GenType Type>
+static bool wanted(int targetPiece) {
+	constexpr int Them = Us == Piece::White ? Piece::Black : Piece::White;
+	if (targetPiece == Piece::None)
+		return Type != moveGenerator::Captures;
+	return Type != moveGenerator::Quiets && Piece::IsColor(targetPiece, Them);
+}
 
-
-void moveGenerator::GenerateKnightMoves(int startSquare, int piece, Board* board, vector<Move>& moves) {
+template<int Us, moveGenerator::GenType Type>
+void moveGenerator::GenerateKnightMoves(int startSquare, Board* board, vector<Move>& moves) {
 	static const int KnightOffsets[] = { -17, -15, -10, -6, 6, 10, 15, 17 };
 
 	int rank = startSquare / 8;
@@ -130,58 +313,38 @@ void moveGenerator::GenerateKnightMoves(int startSquare, int piece, Board* board
 		if (targetSquare < 0 || targetSquare >= 64)
 			continue;
 
-		int newRank = targetSquare / 8;
-		int newFile = targetSquare % 8;
-
-		if (abs(rank - newRank) + abs(file - newFile) != 3)
+		if (abs(rank - targetSquare / 8) + abs(file - targetSquare % 8) != 3)
 			continue; // to prevent wrapping around the board
 
-		int targetPiece = board->Square[targetSquare];
-
-		if (targetPiece == Piece::None || Piece::IsColor(targetPiece, Piece::GetOpponentColor(board->colorToMove))) {
+		if (wanted<Us, Type>(board->Square[targetSquare]))
 			moves.push_back({ startSquare, targetSquare });
-		}
 	}
 }
 
+template<int Us, moveGenerator::GenType Type>
+void moveGenerator::GenerateSlidingMoves(int startSquare, int type, Board* board, vector<Move>& moves) {
+	constexpr int Them = Us == Piece::White ? Piece::Black : Piece::White;
 
-void moveGenerator::GenerateSlidingMoves(int startSquare, int piece, Board* board, vector<Move>& moves) {
-	vector<int> directions;
+	// DirectionOffsets indices: rook lines N, S, E, W, then bishop lines NE, SW, NW, SE
+	static const int Directions[8] = { 0, 1, 3, 2, 6, 7, 4, 5 };
+	int first = (type == Piece::Bishop) ? 4 : 0;
+	int last = (type == Piece::Rook) ? 4 : 8;
 
-	if (Piece().IsRook(piece) || Piece().IsQueen(piece)) {
-		int rookDirs[] = { 8, -8, 1, -1 };
-		directions.insert(directions.end(), begin(rookDirs), end(rookDirs));
-	}
-	if (Piece().IsBishop(piece) || Piece().IsQueen(piece)) {
-		int bishopDirs[] = { 9, -9, 7, -7 };
-		directions.insert(directions.end(), begin(bishopDirs), end(bishopDirs));
-	}
-
-	for (int dir : directions) {
+	for (int i = first; i < last; ++i) {
+		int dir = Directions[i];
+		int offset = PrecomputedMoveData::DirectionOffsets[dir];
 		int targetSquare = startSquare;
 
-		while (true) {
-			int rank = targetSquare / 8;
-			int file = targetSquare % 8;
-
-			targetSquare += dir;
-
-			if (targetSquare < 0 || targetSquare >= 64)
-				break;
-
-			int newRank = targetSquare / 8;
-			int newFile = targetSquare % 8;
-
-			if (abs(newFile - file) > 1 && (dir == 1 || dir == -1 || dir == 9 || dir == -9 || dir == 7 || dir == -7))
-				break;
-
+		for (int n = PrecomputedMoveData::NumSquaresToEdge[startSquare][dir]; n > 0; --n) {
+			targetSquare += offset;
 			int targetPiece = board->Square[targetSquare];
 
 			if (targetPiece == Piece::None) {
-				moves.push_back({ startSquare, targetSquare });
+				if (Type != Captures)
+					moves.push_back({ startSquare, targetSquare });
 			}
 			else {
-				if (Piece::IsColor(targetPiece, Piece::GetOpponentColor(board->colorToMove))) {
+				if (Type != Quiets && Piece::IsColor(targetPiece, Them)) {
 					moves.push_back({ startSquare, targetSquare });
 				}
 				break; // blocked
@@ -190,8 +353,11 @@ void moveGenerator::GenerateSlidingMoves(int startSquare, int piece, Board* boar
 	}
 }
 
-
-void moveGenerator::GenerateKingMoves(int startSquare, int piece, Board* board, vector<Move>& moves) {
+template<int Us, moveGenerator::GenType Type>
+void moveGenerator::GenerateKingMoves(int startSquare, Board* board, vector<Move>& moves) {
+	constexpr int Them = Us == Piece::White ? Piece::Black : Piece::White;
+	constexpr int KingStart = Us == Piece::White ? 4 : 60;
+	constexpr int OwnRook = Piece::Rook | Us;
 	static const int KingOffsets[] = {
 		-9, -8, -7,
 		-1,      1,
@@ -207,51 +373,41 @@ void moveGenerator::GenerateKingMoves(int startSquare, int piece, Board* board,
 		if (targetSquare < 0 || targetSquare >= 64)
 			continue;
 
-		int targetRank = targetSquare / 8;
-		int targetFile = targetSquare % 8;
-
-		if (abs(targetFile - file) > 1 || abs(targetRank - rank) > 1)
+		if (abs(targetSquare % 8 - file) > 1 || abs(targetSquare / 8 - rank) > 1)
 			continue;
 
-		int targetPiece = board->Square[targetSquare];
-
-		if (targetPiece == Piece::None ||
-			Piece::IsColor(targetPiece, Piece::GetOpponentColor(board->colorToMove))) {
+		if (wanted<Us, Type>(board->Square[targetSquare]))
 			moves.push_back(Move(startSquare, targetSquare));
-		}
 	}
 
-	// Castling part
-	int color = Piece::GetColor(piece);
-	bool kingMoved = (color == Piece::White) ? board->whiteKingMoved : board->blackKingMoved;
-	bool kingsideRookMoved = (color == Piece::White) ? board->whiteKingsideRookMoved : board->blackKingsideRookMoved;
-	bool queensideRookMoved = (color == Piece::White) ? board->whiteQueensideRookMoved : board->blackQueensideRookMoved;
+	if (Type == Captures)
+		return;
 
-	int homeRank = (color == Piece::White) ? 0 : 7;
-	int kingStart = homeRank * 8 + 4;
-	int kingsideRook = homeRank * 8 + 7;
-	int queensideRook = homeRank * 8 + 0;
+	// Castling part
+	bool kingMoved = (Us == Piece::White) ? board->whiteKingMoved : board->blackKingMoved;
+	bool kingsideRookMoved = (Us == Piece::White) ? board->whiteKingsideRookMoved : board->blackKingsideRookMoved;
+	bool queensideRookMoved = (Us == Piece::White) ? board->whiteQueensideRookMoved : board->blackQueensideRookMoved;
 
 	// Kingside
-	if (!kingMoved && !kingsideRookMoved &&
-		board->Square[kingStart + 1] == Piece::None &&
-		board->Square[kingStart + 2] == Piece::None &&
-		!board->isSquareAttacked(kingStart, Piece::GetOpponentColor(color), *board) &&
-		!board->isSquareAttacked(kingStart + 1, Piece::GetOpponentColor(color), *board) &&
-		!board->isSquareAttacked(kingStart + 2, Piece::GetOpponentColor(color), *board)) {
-
-		moves.push_back(Move(kingStart, kingStart + 2, Move::KingsideCastle));
+	if (!kingMoved && !kingsideRookMoved && board->Square[KingStart + 3] == OwnRook &&
+		board->Square[KingStart + 1] == Piece::None &&
+		board->Square[KingStart + 2] == Piece::None &&
+		!board->isSquareAttacked(KingStart, Them, *board) &&
+		!board->isSquareAttacked(KingStart + 1, Them, *board) &&
+		!board->isSquareAttacked(KingStart + 2, Them, *board)) {
+
+		moves.push_back(Move(KingStart, KingStart + 2, Move::KingsideCastle));
 	}
 
 	// Queenside
-	if (!kingMoved && !queensideRookMoved &&
-		board->Square[kingStart - 1] == Piece::None &&
-		board->Square[kingStart - 2] == Piece::None &&
-		board->Square[kingStart - 3] == Piece::None &&
-		!board->isSquareAttacked(kingStart, Piece::GetOpponentColor(color), *board) &&
-		!board->isSquareAttacked(kingStart - 1, Piece::GetOpponentColor(color), *board) &&
-		!board->isSquareAttacked(kingStart - 2, Piece::GetOpponentColor(color), *board)) {
-
-		moves.push_back(Move(kingStart, kingStart - 2, Move::QueensideCastle));
+	if (!kingMoved && !queensideRookMoved && board->Square[KingStart - 4] == OwnRook &&
+		board->Square[KingStart - 1] == Piece::None &&
+		board->Square[KingStart - 2] == Piece::None &&
+		board->Square[KingStart - 3] == Piece::None &&
+		!board->isSquareAttacked(KingStart, Them, *board) &&
+		!board->isSquareAttacked(KingStart - 1, Them, *board) &&
+		!board->isSquareAttacked(KingStart - 2, Them, *board)) {
+
+		moves.push_back(Move(KingStart, KingStart - 2, Move::QueensideCastle));
 	}
 }
@@ -8,14 +8,47 @@ using namespace std;
 
 class moveGenerator {
 public:
+    // Captures takes captures, en passant and promotions, Quiets the other moves (castling too).
+    // Evasions are legal replies to check, see GenerateEvasions.
+    enum GenType { All, Captures, Quiets, Evasions };
+
     vector<Move> moves;
 
-    vector<Move> GenerateMoves(Board* board);
+    vector<Move> GenerateMoves(Board* board, GenType type = All);
     vector<Move> GenerateLegalMoves(Board* board);
+    // Legal moves when the side to move is in check, generated directly: king steps, then
+    // captures of the checker and interpositions on its ray by unpinned pieces. In double
+    // check only the king moves.
+    vector<Move> GenerateEvasions(Board* board);
+
+    // True if a move from GenerateMoves keeps the mover's king safe. Plays and undoes it on
+    // the board itself, no copy.
+    bool IsLegalMove(Board* board, Move& move);
+    // A uniformly random legal move for playouts: pseudo-legal moves are drawn at random and
+    // only the drawn ones are tested. False when there is none (checkmate or stalemate).
+    bool GenerateRandomLegalMove(Board* board, mt19937& rng, Move& move);
+
+    // Legal moves of the piece on one square only (none if it is not the side to move's),
+    // for the GUI when a piece is clicked
+    vector<Move> GenerateLegalMovesFrom(Board* board, int square);
+    // Bit n set when some move goes to square n
+    static uint64_t TargetMask(const vector<Move>& moves);
 
 private:
-    void GeneratePawnMoves(int startSquare, int piece, Board* board, vector<Move>& moves);
-    void GenerateKnightMoves(int startSquare, int piece, Board* board, vector<Move>& moves);
-    void GenerateSlidingMoves(int startSquare, int piece, Board* board, vector<Move>& moves);
-    void GenerateKingMoves(int startSquare, int piece, Board* board, vector<Move>& moves);
+    // GenerateMoves into the moves member, without handing out a copy
+    void FillPseudoLegalMoves(Board* board, GenType type = All);
+    void GeneratePieceMoves(int startSquare, int piece, Board* board, vector<Move>& moves);
+
+    // The generators proper, compiled once per colour (Piece::White, Piece::Black) so pawn
+    // directions, home ranks and castling squares are constants. The functions above only
+    // pick the instance for board->colorToMove.
+    template<int Us, GenType Type> void GenerateAllPieces(Board* board, vector<Move>& moves);
+    template<int Us, GenType Type> void GeneratePieceMoves(int startSquare, int piece, Board* board, vector<Move>& moves);
+    template<int Us> void GenerateEvasions(Board* board, vector<Move>& moves);
+    // Moves of unpinned non-king pieces onto one square (capture or block)
+    template<int Us> void GenerateMovesOnto(int targetSquare, Board* board, vector<Move>& moves);
+    template<int Us, GenType Type> void GeneratePawnMoves(int startSquare, Board* board, vector<Move>& moves);
+    template<int Us, GenType Type> void GenerateKnightMoves(int startSquare, Board* board, vector<Move>& moves);
+    template<int Us, GenType Type> void GenerateSlidingMoves(int startSquare, int type, Board* board, vector<Move>& moves);
+    template<int Us, GenType Type> void GenerateKingMoves(int startSquare, Board* board, vector<Move>& moves);
 };
\ No newline at end of file
@@ -1,13 +1,20 @@
 ﻿#include "notation.h"
+#include <cstring>
 
 using namespace std;
 
 string notation::indexToSquare(int index) {
 	char file = 'a' + (index % 8);
-	char rank = '1' + (7 - index / 8); // flip rank so 0 = a8
+	char rank = '1' + (index / 8); // square 0 = a1, same as Board::Square
 	return string() + file + rank;
 }
 
+int notation::squareToIndex(const string& square) {
+	if (square.size() < 2 || square[0] < 'a' || square[0] > 'h' || square[1] < '1' || square[1] > '8')
+		return -1;
+	return (square[1] - '1') * 8 + (square[0] - 'a');
+}
+
 char notation::pieceToChar(int piece) {
 	switch (piece) {
 	case Piece::Knight: return 'N';
@@ -19,55 +26,128 @@ char notation::pieceToChar(int piece) {
 	}
 }
 
-// You’ll need to implement these if you want actual check/mate detection
-bool notation::isCheckAfterMove(const Move& move, const Board& board) {
-	Board tempBoard;
-	Move moveCopy = move;
-	tempBoard.makeMove(moveCopy, tempBoard);
+// Long algebraic form used by UCI: e2e4, e7e8q, 0000 for the null move
+string notation::moveToUCI(const Move& move) {
+	if (move.startSquare == move.targetSquare)
+		return "0000";
 
-	int enemyColor = tempBoard.colorToMove ^ 1;
-	int kingSquare = tempBoard.findKingSquare(enemyColor); // Make sure you have this method
-	cout << tempBoard.isSquareAttacked(kingSquare, tempBoard.colorToMove, board) << endl;
-	return tempBoard.isSquareAttacked(kingSquare, tempBoard.colorToMove, board);
+	string uci = indexToSquare(move.startSquare) + indexToSquare(move.targetSquare);
+	if (move.type == Move::Promotion)
+		uci += static_cast<char>(tolower(pieceToChar(move.promotionPiece)));
+	return uci;
 }
 
-bool notation::isMateAfterMove(const Move& move, const Board& board, moveGenerator gen) {
-	Board tempBoard;
-	Move moveCopy = move;
-	tempBoard.makeMove(moveCopy, tempBoard);
+// Checks the one move a UCI token names instead of generating them all
+bool notation::uciToMove(const string& uci, Board& board, Move& out) {
+	if (uci.size() < 4 || uci.size() > 5)
+		return false;
+	int from = squareToIndex(uci.substr(0, 2));
+	int to = squareToIndex(uci.substr(2, 2));
+	if (from < 0 || to < 0)
+		return false;
+
+	int promotion = Piece::None;
+	if (uci.size() == 5) {
+		switch (uci[4]) {
+		case 'n': promotion = Piece::Knight; break;
+		case 'b': promotion = Piece::Bishop; break;
+		case 'r': promotion = Piece::Rook; break;
+		case 'q': promotion = Piece::Queen; break;
+		default: return false;
+		}
+	}
 
-	int enemyColor = tempBoard.colorToMove;
+	out = board.moveFromSquares(from, to, promotion);
+	return board.isLegal(out);
+}
 
-	// Use your MoveGenerator
-	vector<Move> legalMoves = gen.GenerateLegalMoves(&tempBoard);
+// Finds the legal move a SAN token (Nbd7, exd6, e8=Q+, O-O-O...) stands for.
+// Fails when the token matches no move or more than one.
+bool notation::sanToMove(const char* san, size_t length, const Board& board, const vector<Move>& legalMoves, Move& out) {
+	while (length > 0 && strchr("+#!?", san[length - 1]))
+		length--;
+	if (length < 2)
+		return false;
+
+	// Castling, with letter O or digit zero
+	if (san[0] == 'O' || san[0] == '0') {
+		Move::Type castle = (length >= 5) ? Move::QueensideCastle : Move::KingsideCastle;
+		for (const Move& m : legalMoves) {
+			if (m.type == castle) {
+				out = m;
+				return true;
+			}
+		}
+		return false;
+	}
 
-	for (const Move& m : legalMoves) {
-		Board testBoard = tempBoard;
-		Move testMove = m;
-		testBoard.makeMove(testMove, testBoard);
-
-		int kingSquare = testBoard.findKingSquare(enemyColor);
-		if (!testBoard.isSquareAttacked(kingSquare, enemyColor ^ 1, board)) {
-			cout << "not mate \n";
-			return false; // Found a move that avoids checkmate
+	int pieceType = Piece::Pawn;
+	size_t i = 0;
+	switch (san[0]) {
+	case 'N': pieceType = Piece::Knight; i = 1; break;
+	case 'B': pieceType = Piece::Bishop; i = 1; break;
+	case 'R': pieceType = Piece::Rook;   i = 1; break;
+	case 'Q': pieceType = Piece::Queen;  i = 1; break;
+	case 'K': pieceType = Piece::King;   i = 1; break;
+	}
+
+	int promotion = Piece::None;
+	if (pieceType == Piece::Pawn && length >= 3) {
+		char last = static_cast<char>(toupper(san[length - 1]));
+		if (last == 'N' || last == 'B' || last == 'R' || last == 'Q') {
+			promotion = (last == 'N') ? Piece::Knight : (last == 'B') ? Piece::Bishop : (last == 'R') ? Piece::Rook : Piece::Queen;
+			length -= (san[length - 2] == '=') ? 2 : 1;
 		}
 	}
-	cout << "mate \n";
-	return true; // No legal moves that avoid check → checkmate
+
+	if (length < i + 2)
+		return false;
+	char targetFile = san[length - 2], targetRank = san[length - 1];
+	if (targetFile < 'a' || targetFile > 'h' || targetRank < '1' || targetRank > '8')
+		return false;
+	int target = (targetRank - '1') * 8 + (targetFile - 'a');
+
+	// Whatever sits between the piece letter and the target square disambiguates
+	int fromFile = -1, fromRank = -1;
+	for (size_t k = i; k < length - 2; ++k) {
+		if (san[k] >= 'a' && san[k] <= 'h') fromFile = san[k] - 'a';
+		else if (san[k] >= '1' && san[k] <= '8') fromRank = san[k] - '1';
+	}
+
+	int matches = 0;
+	for (const Move& m : legalMoves) {
+		if (m.targetSquare != target || Piece::Type(board.Square[m.startSquare]) != pieceType)
+			continue;
+		if (fromFile != -1 && m.startSquare % 8 != fromFile)
+			continue;
+		if (fromRank != -1 && m.startSquare / 8 != fromRank)
+			continue;
+		if (m.type == Move::Promotion ? m.promotionPiece != promotion : promotion != Piece::None)
+			continue;
+
+		out = m;
+		matches++;
+	}
+	return matches == 1;
 }
 
+bool notation::sanToMove(const string& san, const Board& board, const vector<Move>& legalMoves, Move& out) {
+	return sanToMove(san.data(), san.size(), board, legalMoves, out);
+}
 
-string notation::moveToSAN(const Move& move, const Board& board, moveGenerator gen) {
-	// Handle castling
+// SAN without the +/# suffix. legalMoves is the legal list of board (the position before
+// the move); it is only scanned for other pieces of the same type reaching the same square.
+string notation::sanWithoutCheck(const Move& move, const Board& board, const vector<Move>& legalMoves) {
 	if (move.type == Move::KingsideCastle) return "O-O";
 	if (move.type == Move::QueensideCastle) return "O-O-O";
 
+	int type = Piece::Type(board.Square[move.startSquare]);
+	bool capture = board.Square[move.targetSquare] != Piece::None || move.type == Move::EnPassant;
 	string san;
-	char pieceChar = pieceToChar(move.movedPiece);
 
 	// For pawn moves
-	if (move.movedPiece == Piece::Pawn) {
-		if (move.type == Move::Capture || move.type == Move::EnPassant) {
+	if (type == Piece::Pawn) {
+		if (capture) {
 			san += 'a' + (move.startSquare % 8); // file of pawn
 			san += 'x';
 		}
@@ -77,45 +157,81 @@ string notation::moveToSAN(const Move& move, const Board& board, moveGenerator g
 			san += '=';
 			san += pieceToChar(move.promotionPiece);
 		}
-	}
-	// For piece moves
-	else {
-		san += pieceChar;
-		if (move.type == Move::Capture) san += 'x';
-		san += indexToSquare(move.targetSquare);
+		return san;
 	}
 
-	// Append check or mate if implemented
-	if (isMateAfterMove(move, board, gen)) {
-		san += '#';
+	// For piece moves, disambiguate by file, then rank, then both
+	san += pieceToChar(type);
+
+	bool ambiguous = false, sameFile = false, sameRank = false;
+	for (const Move& other : legalMoves) {
+		if (other.targetSquare != move.targetSquare || other.startSquare == move.startSquare)
+			continue;
+		if (Piece::Type(board.Square[other.startSquare]) != type)
+			continue;
+		ambiguous = true;
+		if (other.startSquare % 8 == move.startSquare % 8) sameFile = true;
+		if (other.startSquare / 8 == move.startSquare / 8) sameRank = true;
 	}
-	else if (isCheckAfterMove(move, board)) {
-		san += '+';
+	if (ambiguous) {
+		if (!sameFile) san += 'a' + (move.startSquare % 8);
+		else if (!sameRank) san += '1' + (move.startSquare / 8);
+		else san += indexToSquare(move.startSquare);
 	}
 
+	if (capture) san += 'x';
+	san += indexToSquare(move.targetSquare);
 	return san;
 }
 
-string notation::toPGN(const vector<Move>& moves, moveGenerator gen) {
-	string pgn;
-	int moveNumber = 1;
+// "+" or "#" for the position after a move, from that position's legal move list
+string notation::checkSuffix(Board& boardAfterMove, const vector<Move>& replies) {
+	int kingSquare = boardAfterMove.findKingSquare(boardAfterMove.colorToMove);
+	if (!boardAfterMove.isSquareAttacked(kingSquare, Piece::GetOpponentColor(boardAfterMove.colorToMove), boardAfterMove))
+		return "";
+	return replies.empty() ? "#" : "+";
+}
+
+string notation::moveToSAN(const Move& move, Board& board, const vector<Move>& legalMoves, moveGenerator& gen) {
+	string san = sanWithoutCheck(move, board, legalMoves);
+
+	Move moveCopy = move;
+	board.makeMove(moveCopy, board);
+	san += checkSuffix(board, gen.GenerateLegalMoves(&board));
+	board.undoMove(moveCopy);
+
+	return san;
+}
 
-	Board board; // Work on a copy
+// One pass over the game: every position's legal moves are generated exactly once and serve
+// both as the disambiguation list for the move played and as the check/mate test of the move before.
+string notation::toPGN(const Board& start, const vector<Move>& moves, moveGenerator& gen) {
+	string pgn;
+	Board board = start;
+	vector<Move> legal = gen.GenerateLegalMoves(&board);
+	int moveNumber = board.fullmoveNumber;
 
 	for (size_t i = 0; i < moves.size(); ++i) {
-		if (i % 2 == 0) {
+		bool whiteToMove = (board.colorToMove == Piece::White);
+		if (whiteToMove)
 			pgn += to_string(moveNumber) + ". ";
-		}
+		else if (i == 0)
+			pgn += to_string(moveNumber) + "... ";
 
-		string san = moveToSAN(moves[i], board, gen);
-		pgn += san + " ";
+		string san = sanWithoutCheck(moves[i], board, legal);
 
-		Move moveCopy = moves[i];       // 👈 this is the key
-		board.makeMove(moveCopy, board);       // now it's happy
-		if (i % 2 == 1) {
+		Move moveCopy = moves[i];
+		board.makeMove(moveCopy, board);
+		legal = gen.GenerateLegalMoves(&board);
+		pgn += san + checkSuffix(board, legal) + " ";
+
+		if (!whiteToMove)
 			moveNumber++;
-		}
 	}
 
 	return pgn;
-}
\ No newline at end of file
+}
+
+string notation::toPGN(const vector<Move>& moves, moveGenerator gen) {
+	return toPGN(Board(), moves, gen);
+}
@@ -8,9 +8,15 @@ using namespace std;
 class notation {
 public:
 	static string indexToSquare(int index);
+	static int squareToIndex(const string& square);
 	static char pieceToChar(int piece);
-	static bool isCheckAfterMove(const Move& move, const Board& board);
-	static bool isMateAfterMove(const Move& move, const Board& board, moveGenerator gen);
-	static string moveToSAN(const Move& move, const Board& board, moveGenerator gen);
+	static string moveToUCI(const Move& move);
+	static bool uciToMove(const string& uci, Board& board, Move& out);
+	static bool sanToMove(const char* san, size_t length, const Board& board, const vector<Move>& legalMoves, Move& out);
+	static bool sanToMove(const string& san, const Board& board, const vector<Move>& legalMoves, Move& out);
+	static string sanWithoutCheck(const Move& move, const Board& board, const vector<Move>& legalMoves);
+	static string checkSuffix(Board& boardAfterMove, const vector<Move>& replies);
+	static string moveToSAN(const Move& move, Board& board, const vector<Move>& legalMoves, moveGenerator& gen);
+	static string toPGN(const Board& start, const vector<Move>& moves, moveGenerator& gen);
 	static string toPGN(const vector<Move>& moves, moveGenerator gen);
 };
\ No newline at end of file
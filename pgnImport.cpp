@@ -0,0 +1,91 @@
+// pgnImport.cpp
+// Parses a PGN collection with PgnReader on every core and reports what it found.
+// With --store the valid games are also written to a GameStore archive.
+//
+// usage: pgnImport <games.pgn> [--threads n] [--store games.bin]
+#include "PgnReader.h"
+#include "GameStore.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cout << "usage: pgnImport <games.pgn> [--threads n] [--store games.bin]\n";
+		return 1;
+	}
+
+	int threads = max(1u, thread::hardware_concurrency());
+	string storePath;
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--threads")) threads = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--store")) storePath = argv[i + 1];
+	}
+
+	PrecomputedMoveData::Init();
+
+	PgnReader reader(argv[1]);
+	if (!reader.isOpen()) {
+		cout << "Cannot open " << argv[1] << "\n";
+		return 1;
+	}
+
+	unique_ptr<GameStoreWriter> store;
+	if (!storePath.empty()) {
+		store = make_unique<GameStoreWriter>(storePath);
+		if (!store->isOpen()) {
+			cout << "Cannot write " << storePath << "\n";
+			return 1;
+		}
+	}
+
+	// Per-thread encoding state, indexed by the callback's threadIndex
+	struct Encoder {
+		Board start;
+		moveGenerator generator;
+		vector<uint8_t> bytes;
+	};
+	vector<Encoder> encoders(threads);
+
+	atomic<size_t> invalidGames{ 0 }, totalMoves{ 0 };
+	atomic<size_t> whiteWins{ 0 }, blackWins{ 0 }, draws{ 0 };
+
+	auto started = chrono::steady_clock::now();
+	size_t games = reader.read(threads, [&](const PgnGame& game, int threadIndex) {
+		if (!game.valid)
+			invalidGames++;
+		else if (store) {
+			Encoder& e = encoders[threadIndex];
+			if (game.fen.empty())
+				e.start.setFen(Board::StartFen);
+			else
+				e.start.setFen(game.fen.data(), game.fen.size());
+
+			string_view whiteElo = game.tag("WhiteElo"), blackElo = game.tag("BlackElo");
+			if (GameStore::encodeGame(e.start, game.moves, GameStore::resultFromString(game.result),
+				atoi(string(whiteElo).c_str()), atoi(string(blackElo).c_str()), e.generator, e.bytes))
+				store->append(e.bytes);
+		}
+		totalMoves += game.moves.size();
+		if (game.result == "1-0") whiteWins++;
+		else if (game.result == "0-1") blackWins++;
+		else if (game.result == "1/2-1/2") draws++;
+	});
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+	cout << "Games: " << games << " (" << invalidGames << " with an illegal or unreadable move)\n";
+	cout << "Moves: " << totalMoves << "\n";
+	cout << "Results: +" << whiteWins << " =" << draws << " -" << blackWins << "\n";
+	cout << "Time: " << seconds << " s, " << (seconds > 0 ? games / seconds * 60 : 0) << " games/minute, "
+		<< (seconds > 0 ? reader.fileSize() / seconds / (1024 * 1024) : 0) << " MB/s on " << threads << " threads\n";
+
+	if (store) {
+		size_t stored = store->gameCount();
+		store->finish();
+		cout << "Stored " << stored << " games in " << storePath << "\n";
+	}
+	return 0;
+}
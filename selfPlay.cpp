@@ -0,0 +1,147 @@
+// selfPlay.cpp
+// Generates evaluation training data: fixed-node self-play games on every core, with
+// quiet positions (side to move not in check, best move neither a capture nor a
+// promotion) written as 32-byte PackedBoards with the search score and game result.
+// Each game starts with a few random moves so the games don't repeat.
+//
+// usage: selfPlay <out.bin> [--games n] [--threads n] [--nodes n] [--random plies]
+//                 [--minply n] [--maxplies n] [--hash mb]
+#include "Search.h"
+#include "TrainingData.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+struct SelfPlayConfig {
+	int games = 1000;
+	int threads = 1;
+	uint64_t nodes = 5000;
+	int randomPlies = 8;    // random opening moves before the engines take over
+	int minPly = 16;        // positions before this ply are not sampled
+	int maxPlies = 400;     // adjudicated as a draw after this many plies
+	int hashMb = 16;
+};
+
+static bool inCheck(Board& board) {
+	int kingSq = board.kingSquares[board.colorToMove == Piece::White ? 0 : 1];
+	return board.isSquareAttacked(kingSq, Piece::GetOpponentColor(board.colorToMove), board);
+}
+
+static bool isQuiet(const Board& board, const Move& m) {
+	return board.Square[m.targetSquare] == Piece::None && m.type != Move::EnPassant && m.type != Move::Promotion;
+}
+
+// Plays one game and returns its result; the sampled positions go to samples
+static PackedBoard::Result playGame(const SelfPlayConfig& config, Search& search, mt19937& rng, vector<PackedBoard>& samples) {
+	moveGenerator generator;
+	Board board;
+	board.recordPosition();
+	search.newGame();
+	samples.clear();
+
+	SearchLimits limits;
+	limits.nodes = config.nodes;
+
+	for (int ply = 0; ; ++ply) {
+		vector<Move> legal = generator.GenerateLegalMoves(&board);
+		bool whiteToMove = board.colorToMove == Piece::White;
+		if (legal.empty())
+			return !inCheck(board) ? PackedBoard::Draw : whiteToMove ? PackedBoard::BlackWin : PackedBoard::WhiteWin;
+		if (board.halfmoveClock >= 100 || board.isThreefoldRepetition() || board.hasInsufficientMaterial() || ply >= config.maxPlies)
+			return PackedBoard::Draw;
+
+		Move m(0, 0);
+		if (ply < config.randomPlies) {
+			m = legal[uniform_int_distribution<size_t>(0, legal.size() - 1)(rng)];
+		}
+		else {
+			int score = 0;
+			m = search.think(board, limits, [&](const SearchInfo& info) { score = info.score; });
+
+			// A mate score decides the game, the rest would teach nothing new
+			if (Search::isMateScore(score))
+				return ((score > 0) == whiteToMove) ? PackedBoard::WhiteWin : PackedBoard::BlackWin;
+
+			if (ply >= config.minPly && isQuiet(board, m) && !inCheck(board)) {
+				PackedBoard sample = PackedBoard::pack(board);
+				sample.score = static_cast<int16_t>(whiteToMove ? score : -score);
+				samples.push_back(sample);
+			}
+		}
+
+		board.makeMove(m, board);
+		board.recordPosition();
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cout << "usage: selfPlay <out.bin> [--games n] [--threads n] [--nodes n] [--random plies] [--minply n] [--maxplies n] [--hash mb]\n";
+		return 1;
+	}
+
+	SelfPlayConfig config;
+	config.threads = max(1u, thread::hardware_concurrency());
+	for (int i = 2; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--games")) config.games = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--threads")) config.threads = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--nodes")) config.nodes = max(1ull, strtoull(argv[i + 1], nullptr, 10));
+		else if (!strcmp(argv[i], "--random")) config.randomPlies = max(0, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--minply")) config.minPly = max(0, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--maxplies")) config.maxPlies = max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "--hash")) config.hashMb = max(1, atoi(argv[i + 1]));
+	}
+
+	PrecomputedMoveData::Init();
+	TrainingWriter writer(argv[1]);
+	if (!writer.isOpen()) {
+		cout << "Cannot write " << argv[1] << "\n";
+		return 1;
+	}
+
+	atomic<int> nextGame{ 0 };
+	atomic<int> gamesDone{ 0 };
+	mutex outputMutex;
+	auto started = chrono::steady_clock::now();
+
+	auto worker = [&](int threadIndex) {
+		Search search;
+		search.setHashSize(config.hashMb);
+		mt19937 rng(random_device{}() + threadIndex);
+		vector<PackedBoard> samples;
+
+		for (int game = nextGame++; game < config.games; game = nextGame++) {
+			PackedBoard::Result result = playGame(config, search, rng, samples);
+			for (PackedBoard& record : samples)
+				record.result = result;
+			writer.write(samples);
+
+			int done = ++gamesDone;
+			if (done % 100 == 0 || done == config.games) {
+				double hours = chrono::duration<double>(chrono::steady_clock::now() - started).count() / 3600.0;
+				uint64_t positions = writer.written();
+				lock_guard<mutex> guard(outputMutex);
+				cout << "Games " << done << ", positions " << positions
+					<< ", " << static_cast<uint64_t>(positions / max(hours, 1e-9)) << " positions/hour\n";
+			}
+		}
+	};
+
+	vector<thread> pool;
+	for (int i = 0; i < config.threads; ++i)
+		pool.emplace_back(worker, i);
+	for (auto& t : pool)
+		t.join();
+
+	if (!writer.close()) {
+		cout << "Write to " << argv[1] << " failed\n";
+		return 1;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	cout << writer.written() << " positions from " << config.games << " games written to " << argv[1]
+		<< " in " << seconds << " s on " << config.threads << " threads\n";
+	return 0;
+}
@@ -0,0 +1,88 @@
+// selftest.cpp
+// Correctness checks that are kept out of the bench timing run: PolyglotBook::key against
+// the reference keys of the Polyglot book format specification, and the positions of seeded
+// random games round-tripped through PackedBoard and analysed by BatchMoveGenerator, whose
+// legal move counts, check flags and threats must match moveGenerator and Board.
+//
+// usage: selftest [--games n]
+#include "PolyglotBook.h"
+#include "PackedBoard.h"
+#include "BatchMoveGenerator.h"
+#include "moveGenerator.h"
+#include <cstring>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	int games = 64;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--games")) games = max(1, atoi(argv[i + 1]));
+	}
+
+	PrecomputedMoveData::Init();
+
+	bool keysOk = PolyglotBook::checkKeys();
+	cout << "Polyglot keys   : " << (keysOk ? "ok" : "MISMATCH") << endl;
+
+	// The same positions on every run
+	const int MaxPlies = 300;
+	moveGenerator generator;
+	mt19937 rng(20240601);
+	size_t positions = 0, packedFailures = 0;
+	BatchMoveGenerator::Batch batch;
+	BatchMoveGenerator::Result expected;
+
+	for (int game = 0; game < games; ++game) {
+		Board board;
+		board.setFen(Board::StartFen);
+		for (int ply = 0; ply < MaxPlies && board.halfmoveClock < 100; ++ply) {
+			positions++;
+			if (!PackedBoard::roundTrips(board))
+				packedFailures++;
+
+			batch.add(board);
+			int opponent = Piece::GetOpponentColor(board.colorToMove);
+			uint64_t threats = 0;
+			for (int square = 0; square < 64; ++square) {
+				if (board.isSquareAttacked(square, opponent, board))
+					threats |= 1ULL << square;
+			}
+			expected.threats.push_back(threats);
+			expected.inCheck.push_back((threats >> board.findKingSquare(board.colorToMove)) & 1);
+			expected.legalMoves.push_back(static_cast<uint16_t>(generator.GenerateLegalMoves(&board).size()));
+
+			Move move(0, 0);
+			if (!generator.GenerateRandomLegalMove(&board, rng, move))
+				break;
+			board.makeMove(move, board);
+		}
+	}
+
+	cout << "PackedBoard     : ";
+	if (packedFailures == 0)
+		cout << "ok, " << positions << " positions round-tripped" << endl;
+	else
+		cout << "MISMATCH in " << packedFailures << " of " << positions << " positions" << endl;
+
+	BatchMoveGenerator::Result result;
+	BatchMoveGenerator::analyse(batch, result);
+	size_t batchFailures = 0;
+	for (size_t i = 0; i < positions; ++i) {
+		if (result.threats[i] != expected.threats[i] || result.inCheck[i] != expected.inCheck[i]
+			|| result.legalMoves[i] != expected.legalMoves[i])
+			batchFailures++;
+	}
+
+	// Which path BatchMoveGenerator took, assuming the whole build uses the same flags
+#if defined(__AVX2__)
+	cout << "Batch (AVX2)    : ";
+#else
+	cout << "Batch (scalar)  : ";
+#endif
+	if (batchFailures == 0)
+		cout << "ok, " << positions << " positions match moveGenerator" << endl;
+	else
+		cout << "MISMATCH in " << batchFailures << " of " << positions << " positions" << endl;
+
+	return keysOk && packedFailures == 0 && batchFailures == 0 ? 0 : 1;
+}
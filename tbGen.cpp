@@ -0,0 +1,60 @@
+// tbGen.cpp
+// Generates distance-to-mate tablebases by retrograde analysis (see TablebaseGenerator).
+// Tables that the requested ones capture or promote into are generated first.
+//
+// usage: tbGen <directory> [KQvK KRvK ... | all3 | all4] [--threads n]
+//        (no materials: every 3 and 4 piece table)
+#include "TablebaseGenerator.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cout << "usage: tbGen <directory> [KQvK KRvK ... | all3 | all4] [--threads n]\n";
+		return 1;
+	}
+
+	string directory = argv[1];
+	int threads = max(1u, thread::hardware_concurrency());
+	vector<string> materials;
+	for (int i = 2; i < argc; ++i) {
+		if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+			threads = max(1, atoi(argv[++i]));
+		}
+		else if (!strcmp(argv[i], "all3") || !strcmp(argv[i], "all4")) {
+			vector<string> all = TablebaseGenerator::allMaterials(argv[i][3] - '0');
+			materials.insert(materials.end(), all.begin(), all.end());
+		}
+		else {
+			materials.push_back(argv[i]);
+		}
+	}
+	if (materials.empty()) {
+		for (int pieces = 3; pieces <= Tablebase::MaxPieces; ++pieces) {
+			vector<string> all = TablebaseGenerator::allMaterials(pieces);
+			materials.insert(materials.end(), all.begin(), all.end());
+		}
+	}
+
+	PrecomputedMoveData::Init();
+	filesystem::create_directories(directory);
+
+	auto started = chrono::steady_clock::now();
+	for (const string& material : materials) {
+		Tablebase existing(material);
+		if (existing.open(directory + "/" + Tablebase::fileName(existing.material())))
+			continue;
+		if (!TablebaseGenerator::generate(material, directory, threads)) {
+			cout << "Cannot generate " << material << "\n";
+			return 1;
+		}
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	cout << "Done in " << seconds << " s on " << threads << " threads\n";
+	return 0;
+}
@@ -0,0 +1,292 @@
+// texelTune.cpp
+// Tunes the evaluation weights (piece values and piece-square tables) on labelled
+// PackedBoard files such as selfPlay writes. The squared error between the game result and
+// a sigmoid of the static evaluation is minimised with Adam gradient descent on every
+// core, and the tuned weights are written as a replacement EvaluationParameters.h.
+// Positions with six pieces or fewer are skipped: the endgame evaluators in Material
+// score those. --lambda blends the stored search score into the target.
+//
+// usage: texelTune <positions.bin...> [--out EvaluationParameters.h] [--epochs n] [--threads n]
+//                  [--rate r] [--lambda l] [--k k]
+#include "Evaluation.h"
+#include "PackedBoard.h"
+#include "MappedFile.h"
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+// Parameters: PieceValues[Pawn..Queen], then the six tables in EvaluationParameters order
+static const int MaterialParams = 5;
+static const int ParamCount = MaterialParams + 6 * 64;
+static const char* TableNames[6] = { "PawnTable", "KnightTable", "BishopTable", "RookTable", "QueenTable", "KingTable" };
+
+static int tableParam(int type, int index) {
+	return MaterialParams + (type - 1) * 64 + index;
+}
+
+// Feature row for a PackedBoard nibble: white pawn..king 0-5, black pawn..king 6-11
+// (unmoved rooks are rooks; 7 and 15 never occur)
+static const int RowOfNibble[16] = { 0, 1, 2, 3, 4, 5, 3, 0, 6, 7, 8, 9, 10, 11, 9, 6 };
+
+static int lowestBit(uint64_t bits) {
+	static const int DeBruijn[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+	};
+	return DeBruijn[((bits & (0 - bits)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
+
+class Tuner {
+public:
+	vector<PackedBoard> positions;  // kept packed: 32 bytes each, decoded on every pass
+	vector<float> targets;
+	vector<double> params;
+	int threads = 1;
+
+	Tuner() : params(ParamCount) {
+		for (int type = Piece::Pawn; type <= Piece::Queen; ++type)
+			params[type - 1] = EvaluationParameters::PieceValues[type];
+		const int* tables[6] = { EvaluationParameters::PawnTable, EvaluationParameters::KnightTable, EvaluationParameters::BishopTable,
+			EvaluationParameters::RookTable, EvaluationParameters::QueenTable, EvaluationParameters::KingTable };
+		for (int type = Piece::Pawn; type <= Piece::King; ++type) {
+			for (int i = 0; i < 64; ++i)
+				params[tableParam(type, i)] = tables[type - 1][i];
+		}
+	}
+
+	// Adds the positions of a file; result labels blended with sigmoid(k * score) by lambda
+	size_t load(const string& path, double lambda, double k) {
+		MappedFile file;
+		if (!file.open(path))
+			return 0;
+
+		size_t count = file.size() / sizeof(PackedBoard);
+		size_t before = positions.size();
+		positions.resize(before + count);
+		memcpy(positions.data() + before, file.data(), count * sizeof(PackedBoard));
+
+		// Drop small endings and unlabelled records in place
+		size_t kept = before;
+		for (size_t i = before; i < before + count; ++i) {
+			const PackedBoard& packed = positions[i];
+			int pieces = 0;
+			for (uint64_t bits = packed.occupancy; bits; bits &= bits - 1)
+				pieces++;
+			if (pieces <= 6 || pieces > 32 || packed.result > PackedBoard::WhiteWin)
+				continue;
+
+			double result = packed.result / 2.0;
+			double score = 1.0 / (1.0 + exp(-k * packed.score));
+			targets.push_back(static_cast<float>(lambda * score + (1.0 - lambda) * result));
+			positions[kept++] = packed;
+		}
+		positions.resize(kept);
+		return kept - before;
+	}
+
+	// Mean squared error over all samples; with gradient, also d(error)/d(param)
+	double error(double k, vector<double>* gradient) {
+		// Combined value per feature row and square from white's point of view
+		double values[12 * 64];
+		for (int row = 0; row < 12; ++row) {
+			int type = row % 6 + 1;
+			bool white = row < 6;
+			for (int sq = 0; sq < 64; ++sq) {
+				double value = (type == Piece::King ? 0.0 : params[type - 1]) + params[tableParam(type, white ? (sq ^ 56) : sq)];
+				values[row * 64 + sq] = white ? value : -value;
+			}
+		}
+
+		vector<double> errors(threads, 0.0);
+		vector<vector<double>> rowGradients(threads, vector<double>(gradient ? 12 * 64 : 0, 0.0));
+		vector<thread> pool;
+		size_t chunk = (positions.size() + threads - 1) / threads;
+		for (int t = 0; t < threads; ++t) {
+			pool.emplace_back([&, t]() {
+				size_t begin = t * chunk, end = min(positions.size(), begin + chunk);
+				double sum = 0;
+				double* rowGradient = gradient ? rowGradients[t].data() : nullptr;
+				int features[32];
+				for (size_t i = begin; i < end; ++i) {
+					// Decode once into row * 64 + square, used for the score and the gradient
+					const PackedBoard& packed = positions[i];
+					uint64_t nibbles[2];
+					memcpy(nibbles, packed.pieces, sizeof(nibbles));
+					int n = 0;
+					double eval = 0;
+					for (uint64_t bits = packed.occupancy; bits; bits &= bits - 1, ++n) {
+						int nibble = static_cast<int>((nibbles[n >> 4] >> (4 * (n & 15))) & 15);
+						features[n] = RowOfNibble[nibble] * 64 + lowestBit(bits);
+						eval += values[features[n]];
+					}
+
+					double predicted = 1.0 / (1.0 + exp(-k * eval));
+					double difference = predicted - targets[i];
+					sum += difference * difference;
+					if (rowGradient) {
+						double slope = 2.0 * difference * predicted * (1.0 - predicted) * k;
+						for (int p = 0; p < n; ++p)
+							rowGradient[features[p]] += slope;
+					}
+				}
+				errors[t] = sum;
+			});
+		}
+		for (auto& t : pool)
+			t.join();
+
+		double total = 0;
+		for (double e : errors)
+			total += e;
+		double n = max<size_t>(1, positions.size());
+
+		if (gradient) {
+			gradient->assign(ParamCount, 0.0);
+			for (int t = 0; t < threads; ++t) {
+				for (int row = 0; row < 12; ++row) {
+					int type = row % 6 + 1;
+					bool white = row < 6;
+					for (int sq = 0; sq < 64; ++sq) {
+						double g = rowGradients[t][row * 64 + sq] / n * (white ? 1.0 : -1.0);
+						if (type != Piece::King)
+							(*gradient)[type - 1] += g;
+						(*gradient)[tableParam(type, white ? (sq ^ 56) : sq)] += g;
+					}
+				}
+			}
+		}
+		return total / n;
+	}
+
+	// Sigmoid scale that best fits the current weights (golden-section search)
+	double fitK() {
+		double low = 0.0001, high = 0.02;
+		const double ratio = (sqrt(5.0) - 1) / 2;
+		for (int i = 0; i < 30; ++i) {
+			double a = high - ratio * (high - low), b = low + ratio * (high - low);
+			if (error(a, nullptr) < error(b, nullptr))
+				high = b;
+			else
+				low = a;
+		}
+		return (low + high) / 2;
+	}
+
+	void tune(double k, int epochs, double rate) {
+		vector<double> gradient, m(ParamCount, 0.0), v(ParamCount, 0.0);
+		const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+		auto started = chrono::steady_clock::now();
+
+		for (int epoch = 1; epoch <= epochs; ++epoch) {
+			double e = error(k, &gradient);
+			for (int i = 0; i < ParamCount; ++i) {
+				m[i] = beta1 * m[i] + (1 - beta1) * gradient[i];
+				v[i] = beta2 * v[i] + (1 - beta2) * gradient[i] * gradient[i];
+				double mHat = m[i] / (1 - pow(beta1, epoch)), vHat = v[i] / (1 - pow(beta2, epoch));
+				params[i] -= rate * mHat / (sqrt(vHat) + epsilon);
+			}
+
+			if (epoch % 10 == 0 || epoch == epochs) {
+				double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+				cout << "Epoch " << epoch << "  error " << setprecision(8) << e << "  "
+					<< setprecision(3) << seconds / epoch << " s/epoch\n";
+			}
+		}
+	}
+
+	bool writeHeader(const string& path) const {
+		ofstream out(path);
+		if (!out)
+			return false;
+
+		out << "#pragma once\n\n#include \"useFullStuff.h\"\n\nusing namespace std;\n\n";
+		out << "// Evaluation weights, kept apart from the code so texelTune can write a tuned copy of this\n";
+		out << "// file. PieceValues is indexed by piece type (None, Pawn ... King).\n";
+		out << "struct EvaluationParameters {\n";
+		out << "\tstatic constexpr array<int, 7> PieceValues = {\n\t\t0";
+		for (int type = Piece::Pawn; type <= Piece::Queen; ++type)
+			out << ", " << lround(params[type - 1]);
+		out << ", 0\n\t};\n\n";
+
+		out << "\t// Piece-square tables are written rank 8 first (as you look at the board from white's side),\n";
+		out << "\t// so a white piece on square sq reads index sq ^ 56 and a black piece reads index sq.\n";
+		for (int type = Piece::Pawn; type <= Piece::King; ++type) {
+			if (type != Piece::Pawn)
+				out << "\n";
+			out << "\tstatic constexpr int " << TableNames[type - 1] << "[64] = {\n";
+			for (int rank = 0; rank < 8; ++rank) {
+				out << "\t\t";
+				for (int file = 0; file < 8; ++file) {
+					out << setw(3) << lround(params[tableParam(type, rank * 8 + file)]);
+					if (file < 7 || rank < 7)
+						out << (file < 7 ? ", " : ",");
+				}
+				out << "\n";
+			}
+			out << "\t};\n";
+		}
+		out << "};\n";
+		return static_cast<bool>(out);
+	}
+};
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		cout << "usage: texelTune <positions.bin...> [--out EvaluationParameters.h] [--epochs n] [--threads n] [--rate r] [--lambda l] [--k k]\n";
+		return 1;
+	}
+
+	vector<string> inputs;
+	string outPath = "EvaluationParameters.h";
+	int epochs = 200;
+	double rate = 1.0, lambda = 0.0, k = 0.0;
+	Tuner tuner;
+	tuner.threads = max(1u, thread::hardware_concurrency());
+	for (int i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--", 2) != 0) { inputs.push_back(argv[i]); continue; }
+		if (i + 1 >= argc) break;
+		if (!strcmp(argv[i], "--out")) outPath = argv[++i];
+		else if (!strcmp(argv[i], "--epochs")) epochs = max(0, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--threads")) tuner.threads = max(1, atoi(argv[++i]));
+		else if (!strcmp(argv[i], "--rate")) rate = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--lambda")) lambda = min(1.0, max(0.0, atof(argv[++i])));
+		else if (!strcmp(argv[i], "--k")) k = atof(argv[++i]);
+		else ++i;
+	}
+
+	// The score blend needs a scale before loading; the usual fit lands close to this
+	double loadK = (k > 0) ? k : 0.004;
+	auto started = chrono::steady_clock::now();
+	for (const string& path : inputs) {
+		size_t added = tuner.load(path, lambda, loadK);
+		cout << path << ": " << added << " positions\n";
+	}
+	if (tuner.positions.empty()) {
+		cout << "No positions loaded\n";
+		return 1;
+	}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	cout << "Loaded " << tuner.positions.size() << " positions in " << seconds << " s\n";
+
+	if (k <= 0) {
+		k = tuner.fitK();
+		cout << "Fitted k = " << k << "\n";
+	}
+	cout << "Start error " << setprecision(8) << tuner.error(k, nullptr) << "\n";
+
+	tuner.tune(k, epochs, rate);
+
+	if (!tuner.writeHeader(outPath)) {
+		cout << "Cannot write " << outPath << "\n";
+		return 1;
+	}
+	cout << "Tuned weights written to " << outPath << "\n";
+	return 0;
+}
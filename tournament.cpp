@@ -0,0 +1,457 @@
+// tournament.cpp
+// Headless Agent vs Agent runner: plays many games at once on a pool of threads,
+// adjudicates decided games, can stop early with an SPRT and writes every game as PGN.
+//
+// usage: tournament --engine name=A depth=4 --engine name=B nodes=20000 [random] [movetime=ms] [hash=mb] [book=file.bin]
+//                   [mcts] [selection=uct|puct] [playout=random|light] [threads=n]
+//                   [--games n] [--concurrency n] [--openings file.epd] [--pgn out.pgn]
+//                   [--sprt elo0=0 elo1=10 alpha=0.05 beta=0.05]
+//                   [--maxplies n] [--draw movenumber=40 movecount=8 score=10] [--resign movecount=3 score=600]
+#include "Search.h"
+#include "Mcts.h"
+#include "FenReader.h"
+#include "PolyglotBook.h"
+#include "notation.h"
+#include <thread>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+struct EngineConfig {
+	string name = "engine";
+	SearchLimits limits;
+	int hashMb = 16;
+	bool random = false; // plays like Agent::playRandomMove
+	string bookPath;     // Polyglot book, weighted random choice while in book
+
+	// Monte Carlo tree search instead of alpha-beta; nodes= counts playouts, hash= sizes the tree
+	bool mcts = false;
+	Mcts::Selection selection = Mcts::Uct;
+	Mcts::Playout playout = Mcts::RandomPlayout;
+	int threads = 1;
+};
+
+struct TournamentConfig {
+	EngineConfig engines[2];
+	int games = 100;
+	int concurrency = 1;
+	string openingsPath;
+	string pgnPath = "tournament.pgn";
+	int maxPlies = 400;
+
+	// Draw once both sides stayed within drawScore for drawMoveCount plies after drawMoveNumber
+	int drawMoveNumber = 40, drawMoveCount = 8, drawScore = 10;
+	// Resign once the same side was judged lost by resignScore for resignMoveCount plies
+	int resignMoveCount = 3, resignScore = 600;
+
+	bool sprt = false;
+	double elo0 = 0, elo1 = 10, alpha = 0.05, beta = 0.05;
+};
+
+struct GameRecord {
+	string startFen;
+	vector<string> san;
+	string result;      // "1-0", "0-1", "1/2-1/2"
+	string termination;
+	int whiteEngine = 0;
+};
+
+static bool readKeyValue(const char* arg, string& key, string& value) {
+	const char* eq = strchr(arg, '=');
+	if (!eq)
+		return false;
+	key.assign(arg, eq - arg);
+	value = eq + 1;
+	return true;
+}
+
+static bool inCheck(Board& board) {
+	int kingSq = board.findKingSquare(board.colorToMove);
+	return board.isSquareAttacked(kingSq, Piece::GetOpponentColor(board.colorToMove), board);
+}
+
+class Tournament {
+private:
+	TournamentConfig config;
+	vector<string> openings;
+	PolyglotBook books[2];
+
+	mutex resultMutex;
+	ofstream pgn;
+	atomic<int> nextGame{ 0 };
+	atomic<bool> stopFlag{ false };
+	int gamesPlayed = 0;
+	int wins = 0, losses = 0, draws = 0; // from engine 0's point of view
+	string sprtVerdict;
+
+public:
+	Tournament(const TournamentConfig& cfg) : config(cfg) {
+		if (!config.openingsPath.empty()) {
+			FenReader reader(config.openingsPath);
+			Board board;
+			const char* line;
+			size_t length;
+			while (reader.nextLine(line, length)) {
+				if (board.setFen(line, length))
+					openings.push_back(board.getFen());
+			}
+		}
+		if (openings.empty())
+			openings.push_back(Board::StartFen);
+
+		for (int e = 0; e < 2; ++e) {
+			if (!config.engines[e].bookPath.empty() && !books[e].open(config.engines[e].bookPath))
+				cerr << "Cannot open book " << config.engines[e].bookPath << "\n";
+		}
+
+		pgn.open(config.pgnPath);
+	}
+
+	void run() {
+		vector<thread> pool;
+		for (int i = 0; i < config.concurrency; ++i)
+			pool.emplace_back([this]() { worker(); });
+		for (auto& t : pool)
+			t.join();
+
+		printSummary();
+	}
+
+private:
+	void worker() {
+		Search searches[2];
+		unique_ptr<Mcts> trees[2];
+		mt19937 rng(random_device{}());
+		for (int e = 0; e < 2; ++e) {
+			const EngineConfig& cfg = config.engines[e];
+			if (cfg.mcts) {
+				trees[e] = make_unique<Mcts>();
+				trees[e]->setTreeSize(cfg.hashMb);
+				trees[e]->setThreads(cfg.threads);
+				trees[e]->setSelection(cfg.selection);
+				trees[e]->setPlayout(cfg.playout);
+			}
+			else {
+				searches[e].setHashSize(cfg.hashMb);
+				searches[e].setThreads(cfg.threads);
+			}
+		}
+
+		for (int game = nextGame++; game < config.games && !stopFlag; game = nextGame++) {
+			// Every opening is played twice with colours reversed
+			GameRecord record;
+			record.startFen = openings[(game / 2) % openings.size()];
+			record.whiteEngine = game % 2;
+
+			playGame(record, searches, trees, rng);
+			recordResult(record, game);
+		}
+	}
+
+	Move pickMove(int engine, Board& board, const vector<Move>& legal, Search searches[2], unique_ptr<Mcts> trees[2], mt19937& rng, int& score) {
+		const EngineConfig& cfg = config.engines[engine];
+		score = 0;
+		Move bookMove(0, 0);
+		if (books[engine].probe(board, legal, bookMove, &rng))
+			return bookMove;
+		if (cfg.random)
+			return legal[uniform_int_distribution<size_t>(0, legal.size() - 1)(rng)];
+
+		auto onInfo = [&](const SearchInfo& info) {
+			score = info.score;
+		};
+		if (trees[engine])
+			return trees[engine]->think(board, cfg.limits, onInfo);
+		return searches[engine].think(board, cfg.limits, onInfo);
+	}
+
+	void playGame(GameRecord& record, Search searches[2], unique_ptr<Mcts> trees[2], mt19937& rng) {
+		Board board;
+		board.setFen(record.startFen);
+		board.recordPosition();
+		for (int e = 0; e < 2; ++e) {
+			searches[e].newGame();
+			if (trees[e])
+				trees[e]->newGame();
+		}
+
+		moveGenerator generator;
+		vector<Move> legal = generator.GenerateLegalMoves(&board);
+		int drawPlies = 0;
+		int resignPlies[2] = { 0, 0 };
+
+		for (int ply = 0; ; ++ply) {
+			int whiteToMove = (board.colorToMove == Piece::White);
+
+			if (legal.empty()) {
+				if (inCheck(board)) {
+					record.result = whiteToMove ? "0-1" : "1-0";
+					record.termination = "checkmate";
+				}
+				else {
+					record.result = "1/2-1/2";
+					record.termination = "stalemate";
+				}
+				return;
+			}
+			if (board.halfmoveClock >= 100) { record.result = "1/2-1/2"; record.termination = "fifty-move rule"; return; }
+			if (board.isThreefoldRepetition()) { record.result = "1/2-1/2"; record.termination = "threefold repetition"; return; }
+			if (board.hasInsufficientMaterial()) { record.result = "1/2-1/2"; record.termination = "insufficient material"; return; }
+			if (ply >= config.maxPlies) { record.result = "1/2-1/2"; record.termination = "adjudication: max plies"; return; }
+
+			int engine = whiteToMove ? record.whiteEngine : 1 - record.whiteEngine;
+			int score;
+			Move m = pickMove(engine, board, legal, searches, trees, rng, score);
+
+			// Mate found by the mover decides the game (a lost mate score means it is lost)
+			if (!config.engines[engine].random && Search::isMateScore(score)) {
+				bool moverWins = score > 0;
+				record.result = (moverWins == (whiteToMove != 0)) ? "1-0" : "0-1";
+				record.termination = "adjudication: mate score";
+				return;
+			}
+
+			// Draw adjudication on small scores late in the game
+			if (board.fullmoveNumber >= config.drawMoveNumber && abs(score) <= config.drawScore && !config.engines[engine].random)
+				drawPlies++;
+			else
+				drawPlies = 0;
+			if (config.drawMoveCount > 0 && drawPlies >= config.drawMoveCount) {
+				record.result = "1/2-1/2";
+				record.termination = "adjudication: draw score";
+				return;
+			}
+
+			// Resign adjudication when the mover keeps seeing itself lost
+			int side = whiteToMove ? 0 : 1;
+			resignPlies[side] = (!config.engines[engine].random && score <= -config.resignScore) ? resignPlies[side] + 1 : 0;
+			if (config.resignMoveCount > 0 && resignPlies[side] >= config.resignMoveCount) {
+				record.result = whiteToMove ? "0-1" : "1-0";
+				record.termination = "adjudication: resign score";
+				return;
+			}
+
+			string san = notation::sanWithoutCheck(m, board, legal);
+			board.makeMove(m, board);
+			board.recordPosition();
+
+			// The next position's legal list gives the check and mate suffix for free
+			legal = generator.GenerateLegalMoves(&board);
+			record.san.push_back(san + notation::checkSuffix(board, legal));
+		}
+	}
+
+	void recordResult(const GameRecord& record, int game) {
+		lock_guard<mutex> lock(resultMutex);
+
+		gamesPlayed++;
+		double whiteScore = (record.result == "1-0") ? 1.0 : (record.result == "0-1") ? 0.0 : 0.5;
+		double engine0Score = (record.whiteEngine == 0) ? whiteScore : 1.0 - whiteScore;
+		if (engine0Score == 1.0) wins++;
+		else if (engine0Score == 0.0) losses++;
+		else draws++;
+
+		writePgn(record, game);
+
+		cout << "Game " << (game + 1) << ": " << config.engines[record.whiteEngine].name << " vs "
+			<< config.engines[1 - record.whiteEngine].name << " " << record.result
+			<< " {" << record.termination << "}  Score " << wins << " - " << losses << " - " << draws << "\n";
+
+		if (config.sprt && sprtVerdict.empty()) {
+			double llr, lower, upper;
+			sprt(llr, lower, upper);
+			if (llr >= upper) sprtVerdict = "H1 accepted";
+			else if (llr <= lower) sprtVerdict = "H0 accepted";
+			if (!sprtVerdict.empty())
+				stopFlag = true;
+		}
+	}
+
+	// Called under resultMutex as soon as the game ends, so localtime is safe and its date is the game's
+	void writePgn(const GameRecord& record, int game) {
+		const string& white = config.engines[record.whiteEngine].name;
+		const string& black = config.engines[1 - record.whiteEngine].name;
+
+		char date[16] = "????.??.??";
+		time_t now = time(nullptr);
+		if (const tm* local = localtime(&now))
+			strftime(date, sizeof(date), "%Y.%m.%d", local);
+
+		pgn << "[Event \"Self-play tournament\"]\n";
+		pgn << "[Site \"chessWithCpp\"]\n";
+		pgn << "[Date \"" << date << "\"]\n";
+		pgn << "[Round \"" << (game + 1) << "\"]\n";
+		pgn << "[White \"" << white << "\"]\n";
+		pgn << "[Black \"" << black << "\"]\n";
+		pgn << "[Result \"" << record.result << "\"]\n";
+		if (record.startFen != Board::StartFen) {
+			pgn << "[SetUp \"1\"]\n";
+			pgn << "[FEN \"" << record.startFen << "\"]\n";
+		}
+		pgn << "[Termination \"" << record.termination << "\"]\n\n";
+
+		Board start;
+		start.setFen(record.startFen);
+		int moveNumber = start.fullmoveNumber;
+		bool whiteToMove = (start.colorToMove == Piece::White);
+		int column = 0;
+
+		for (size_t i = 0; i < record.san.size(); ++i) {
+			string token;
+			if (whiteToMove)
+				token = to_string(moveNumber) + ". ";
+			else if (i == 0)
+				token = to_string(moveNumber) + "... ";
+			token += record.san[i];
+
+			if (column + token.size() > 79) {
+				pgn << "\n";
+				column = 0;
+			}
+			else if (column > 0) {
+				pgn << " ";
+				column++;
+			}
+			pgn << token;
+			column += static_cast<int>(token.size());
+
+			if (!whiteToMove)
+				moveNumber++;
+			whiteToMove = !whiteToMove;
+		}
+		pgn << (column > 0 ? " " : "") << record.result << "\n\n";
+		pgn.flush();
+	}
+
+	// Score fraction and per-game variance of engine 0's results
+	void scoreStats(double& score, double& variance) const {
+		double n = max(1, gamesPlayed);
+		score = (wins + 0.5 * draws) / n;
+		variance = (wins * pow(1.0 - score, 2) + draws * pow(0.5 - score, 2) + losses * pow(score, 2)) / n;
+	}
+
+	static double eloToScore(double elo) {
+		return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+	}
+
+	static double scoreToElo(double score) {
+		score = min(max(score, 1e-6), 1.0 - 1e-6);
+		return -400.0 * log10(1.0 / score - 1.0);
+	}
+
+	// Normal approximation of the log-likelihood ratio for H1 (elo1) against H0 (elo0).
+	// Half a game is added to each outcome so a run of identical results has a variance.
+	void sprt(double& llr, double& lower, double& upper) const {
+		lower = log(config.beta / (1.0 - config.alpha));
+		upper = log((1.0 - config.beta) / config.alpha);
+
+		double w = wins + 0.5, d = draws + 0.5, l = losses + 0.5;
+		double n = w + d + l;
+		double score = (w + 0.5 * d) / n;
+		double variance = (w * pow(1.0 - score, 2) + d * pow(0.5 - score, 2) + l * pow(score, 2)) / n;
+
+		double s0 = eloToScore(config.elo0), s1 = eloToScore(config.elo1);
+		llr = 0.5 * n * (pow(score - s0, 2) - pow(score - s1, 2)) / variance;
+	}
+
+	void printSummary() {
+		double score, variance;
+		scoreStats(score, variance);
+		double margin = 1.96 * sqrt(variance / max(1, gamesPlayed));
+		double elo = scoreToElo(score);
+		double eloLow = scoreToElo(score - margin), eloHigh = scoreToElo(score + margin);
+
+		cout << fixed;
+		cout.precision(1);
+		cout << "\nScore of " << config.engines[0].name << " vs " << config.engines[1].name << ": "
+			<< wins << " - " << losses << " - " << draws << "  [" << score * 100 << "%] " << gamesPlayed << " games\n";
+		cout << "Elo difference: " << elo << " +/- " << (eloHigh - eloLow) / 2
+			<< "  (95%: " << eloLow << " .. " << eloHigh << ")\n";
+
+		if (config.sprt) {
+			double llr, lower, upper;
+			sprt(llr, lower, upper);
+			cout.precision(2);
+			cout << "SPRT: elo0=" << config.elo0 << " elo1=" << config.elo1 << "  LLR " << llr
+				<< " [" << lower << ", " << upper << "]  "
+				<< (sprtVerdict.empty() ? string("inconclusive") : sprtVerdict) << "\n";
+		}
+		cout << "PGN written to " << config.pgnPath << endl;
+	}
+};
+
+int main(int argc, char* argv[]) {
+	TournamentConfig config;
+	config.concurrency = max(1u, thread::hardware_concurrency());
+	config.engines[0].name = "A";
+	config.engines[1].name = "B";
+	config.engines[0].limits.depth = config.engines[1].limits.depth = 3;
+
+	int engineCount = 0;
+	string key, value;
+	for (int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+
+		if (arg == "--engine" && engineCount < 2) {
+			EngineConfig& e = config.engines[engineCount++];
+			e = EngineConfig();
+			e.name = "engine" + to_string(engineCount);
+			for (; i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0; ++i) {
+				if (!strcmp(argv[i + 1], "random")) { e.random = true; continue; }
+				if (!strcmp(argv[i + 1], "mcts")) { e.mcts = true; continue; }
+				if (!readKeyValue(argv[i + 1], key, value)) continue;
+				if (key == "name") e.name = value;
+				else if (key == "depth") e.limits.depth = stoi(value);
+				else if (key == "nodes") e.limits.nodes = stoull(value);
+				else if (key == "movetime") e.limits.movetime = stoi(value);
+				else if (key == "hash") e.hashMb = stoi(value);
+				else if (key == "book") e.bookPath = value;
+				else if (key == "threads") e.threads = max(1, stoi(value));
+				else if (key == "selection") e.selection = (value == "puct") ? Mcts::Puct : Mcts::Uct;
+				else if (key == "playout") e.playout = (value == "light") ? Mcts::LightPlayout : Mcts::RandomPlayout;
+			}
+			if (!e.random && e.limits.depth == 0 && e.limits.nodes == 0 && e.limits.movetime == 0)
+				e.limits.depth = 3;
+		}
+		else if (arg == "--sprt") {
+			config.sprt = true;
+			for (; i + 1 < argc && readKeyValue(argv[i + 1], key, value); ++i) {
+				if (key == "elo0") config.elo0 = stod(value);
+				else if (key == "elo1") config.elo1 = stod(value);
+				else if (key == "alpha") config.alpha = stod(value);
+				else if (key == "beta") config.beta = stod(value);
+			}
+		}
+		else if (arg == "--draw") {
+			for (; i + 1 < argc && readKeyValue(argv[i + 1], key, value); ++i) {
+				if (key == "movenumber") config.drawMoveNumber = stoi(value);
+				else if (key == "movecount") config.drawMoveCount = stoi(value);
+				else if (key == "score") config.drawScore = stoi(value);
+			}
+		}
+		else if (arg == "--resign") {
+			for (; i + 1 < argc && readKeyValue(argv[i + 1], key, value); ++i) {
+				if (key == "movecount") config.resignMoveCount = stoi(value);
+				else if (key == "score") config.resignScore = stoi(value);
+			}
+		}
+		else if (i + 1 < argc) {
+			if (arg == "--games") config.games = atoi(argv[++i]);
+			else if (arg == "--concurrency") config.concurrency = max(1, atoi(argv[++i]));
+			else if (arg == "--openings") config.openingsPath = argv[++i];
+			else if (arg == "--pgn") config.pgnPath = argv[++i];
+			else if (arg == "--maxplies") config.maxPlies = atoi(argv[++i]);
+		}
+	}
+
+	PrecomputedMoveData::Init();
+
+	Tournament tournament(config);
+	tournament.run();
+	return 0;
+}
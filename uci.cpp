@@ -0,0 +1,256 @@
+// uci.cpp
+// Entry point of the chess-uci executable: talks the UCI protocol on stdin/stdout.
+// Build it from the engine sources without main.cpp (no window is opened).
+// "chess-uci bench [depth]" runs the fixed-position benchmark instead.
+#include "Search.h"
+#include "Mcts.h"
+#include "Bench.h"
+#include "PolyglotBook.h"
+#include "notation.h"
+#include <thread>
+#include <mutex>
+#include <sstream>
+
+using namespace std;
+
+static mutex outputMutex;
+
+static void send(const string& line) {
+	lock_guard<mutex> lock(outputMutex);
+	cout << line << endl;
+}
+
+class UciEngine {
+private:
+	Board board;
+	Search search;
+	Mcts mcts;
+	bool useMcts = false; // EngineType MCTS: nodes and nps count playouts
+	moveGenerator generator;
+	thread searchThread;
+	atomic<bool> searchDone{ true };
+	PolyglotBook book;
+	string bookFile = "book.bin";
+	bool ownBook = false;
+	TablebaseSet tablebases;
+	mt19937 rng{ random_device{}() };
+
+	void waitForSearch() {
+		if (!searchThread.joinable())
+			return;
+
+		// Keep signalling: a stop sent before think() resets its flag would otherwise be lost
+		while (!searchDone) {
+			search.stop();
+			mcts.stop();
+			this_thread::sleep_for(chrono::milliseconds(1));
+		}
+		searchThread.join();
+	}
+
+	bool applyMove(const string& text) {
+		Move m(0, 0);
+		if (!notation::uciToMove(text, board, m))
+			return false;
+		board.makeMove(m, board);
+		board.recordPosition();
+		return true;
+	}
+
+	void position(istringstream& in) {
+		string token, fen;
+		in >> token;
+
+		if (token == "startpos") {
+			fen = Board::StartFen;
+			in >> token; // "moves" or nothing
+		}
+		else if (token == "fen") {
+			while (in >> token && token != "moves")
+				fen += token + " ";
+		}
+		else {
+			return;
+		}
+
+		board.setFen(fen);
+		board.recordPosition();
+
+		while (in >> token) {
+			if (!applyMove(token)) {
+				send("info string illegal move " + token);
+				break;
+			}
+		}
+	}
+
+	void go(istringstream& in) {
+		SearchLimits limits;
+		string token;
+
+		while (in >> token) {
+			if (token == "depth") in >> limits.depth;
+			else if (token == "nodes") in >> limits.nodes;
+			else if (token == "movetime") in >> limits.movetime;
+			else if (token == "wtime") in >> limits.wtime;
+			else if (token == "btime") in >> limits.btime;
+			else if (token == "winc") in >> limits.winc;
+			else if (token == "binc") in >> limits.binc;
+			else if (token == "movestogo") in >> limits.movestogo;
+			else if (token == "infinite") limits.infinite = true;
+			else if (token == "ponder") limits.ponder = true;
+		}
+
+		// A book move is played at once and costs no search time
+		if (ownBook && !limits.infinite && !limits.ponder) {
+			Move bookMove(0, 0);
+			if (book.probe(board, generator.GenerateLegalMoves(&board), bookMove, &rng)) {
+				send("bestmove " + notation::moveToUCI(bookMove));
+				return;
+			}
+		}
+
+		Board root = board;
+		searchDone = false;
+		searchThread = thread([this, root, limits]() {
+			auto onInfo = [](const SearchInfo& info) {
+				ostringstream line;
+				line << "info depth " << info.depth << " score ";
+				if (Search::isMateScore(info.score))
+					line << "mate " << Search::mateInMoves(info.score);
+				else
+					line << "cp " << info.score;
+				line << " nodes " << info.nodes;
+				if (info.tbHits > 0)
+					line << " tbhits " << info.tbHits;
+				line << " time " << info.timeMs
+					<< " nps " << (info.timeMs > 0 ? info.nodes * 1000 / info.timeMs : info.nodes);
+				if (!info.pv.empty()) {
+					line << " pv";
+					for (const Move& m : info.pv)
+						line << " " << notation::moveToUCI(m);
+				}
+				send(line.str());
+			};
+			Move best = useMcts ? mcts.think(root, limits, onInfo) : search.think(root, limits, onInfo);
+			send("bestmove " + notation::moveToUCI(best));
+			searchDone = true;
+		});
+	}
+
+	void setOption(istringstream& in) {
+		string token, name, value;
+		in >> token; // "name"
+		while (in >> token && token != "value")
+			name += (name.empty() ? "" : " ") + token;
+		in >> value;
+
+		if (name == "Hash") {
+			search.setHashSize(atoi(value.c_str()));
+			mcts.setTreeSize(atoi(value.c_str()));
+		}
+		else if (name == "Threads") {
+			search.setThreads(atoi(value.c_str()));
+			mcts.setThreads(atoi(value.c_str()));
+		}
+		else if (name == "EngineType")
+			useMcts = (value == "MCTS");
+		else if (name == "OwnBook")
+			ownBook = (value == "true");
+		else if (name == "BookFile")
+			bookFile = value;
+		else if (name == "TablebasePath") {
+			int count = value.empty() ? 0 : tablebases.open(value);
+			search.setTablebases(count > 0 ? &tablebases : nullptr);
+			send("info string " + to_string(count) + " tablebases loaded");
+		}
+
+		if ((name == "OwnBook" || name == "BookFile") && ownBook && !book.open(bookFile))
+			send("info string cannot open book " + bookFile);
+	}
+
+public:
+	UciEngine() {
+		board.recordPosition();
+	}
+
+	~UciEngine() {
+		waitForSearch();
+	}
+
+	void run() {
+		string line;
+		while (getline(cin, line)) {
+			istringstream in(line);
+			string command;
+			in >> command;
+
+			if (command == "uci") {
+				send("id name chessWithCpp");
+				send("id author slime306-sky");
+				send("option name Hash type spin default 16 min 1 max 4096");
+				send("option name Threads type spin default 1 min 1 max 64");
+				send("option name Ponder type check default false");
+				send("option name OwnBook type check default false");
+				send("option name BookFile type string default book.bin");
+				send("option name TablebasePath type string default <empty>");
+				send("option name EngineType type combo default AlphaBeta var AlphaBeta var MCTS");
+				send("uciok");
+			}
+			else if (command == "isready") {
+				send("readyok");
+			}
+			else if (command == "ucinewgame") {
+				waitForSearch();
+				search.newGame();
+				mcts.newGame();
+				board.setFen(Board::StartFen);
+				board.recordPosition();
+			}
+			else if (command == "position") {
+				waitForSearch();
+				position(in);
+			}
+			else if (command == "go") {
+				waitForSearch();
+				go(in);
+			}
+			else if (command == "stop") {
+				waitForSearch();
+			}
+			else if (command == "ponderhit") {
+				if (useMcts)
+					mcts.ponderHit();
+				else
+					search.ponderHit();
+			}
+			else if (command == "setoption") {
+				waitForSearch();
+				setOption(in);
+			}
+			else if (command == "bench") {
+				waitForSearch();
+				int depth = Bench::DefaultDepth;
+				in >> depth;
+				Bench::run(depth);
+			}
+			else if (command == "quit") {
+				break;
+			}
+		}
+	}
+};
+
+int main(int argc, char* argv[]) {
+	PrecomputedMoveData::Init();
+
+	// chess-uci bench [depth]: run the benchmark and exit
+	if (argc > 1 && string(argv[1]) == "bench") {
+		Bench::run(argc > 2 ? atoi(argv[2]) : Bench::DefaultDepth);
+		return 0;
+	}
+
+	UciEngine engine;
+	engine.run();
+	return 0;
+}
@@ -9,7 +9,8 @@ Move::Move(int from, int to, Type t, int promo)
     enPassantCapturedSquare(-1), enPassantSquareBeforeMove(-1),
     whiteKingMovedBefore(false), blackKingMovedBefore(false),
     whiteKingsideRookMovedBefore(false), whiteQueensideRookMovedBefore(false),
-    blackKingsideRookMovedBefore(false), blackQueensideRookMovedBefore(false) {
+    blackKingsideRookMovedBefore(false), blackQueensideRookMovedBefore(false),
+    halfmoveClockBefore(0), zobristKeyBefore(0) {
     for (int i = 0; i < 4; ++i) castlingRightsBeforeMove[i] = false;
 }
 
@@ -60,6 +60,8 @@ struct Move {
     bool whiteQueensideRookMovedBefore;
     bool blackKingsideRookMovedBefore;
     bool blackQueensideRookMovedBefore;
+    int halfmoveClockBefore;
+    uint64_t zobristKeyBefore;
 
     Move(int from, int to, Type t = Normal, int promo = 0);
 };